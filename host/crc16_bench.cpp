@@ -0,0 +1,138 @@
+/**
+ * @brief Timing Of The CRC16 Implementations
+ *
+ * The sketch selects one implementation at compile time, so the source is
+ * included here once per variant, each in its own namespace. All variants
+ * see the same random frames of PCA_PAYLOAD_LEN - 2 bytes (the part covered
+ * by the CRC) and must agree on every result.
+ *
+ * The times are host CPU times, they rank the variants but do not predict
+ * AVR cycles: there every pgm_read_word is an LPM and every shift by one
+ * bit is a separate instruction.
+ *
+ * Copyright (c) 2017, Sven Bachmann <dev@mcbachmann.de>
+ *
+ * Licensed under the MIT license, see LICENSE for details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "hal.h"
+#include "crc16_pca301.h"
+#include "pca301_rfm69.h"
+#include "crc16_bench.h"
+
+#undef CRC16_PCA301_IMPL
+#define CRC16_PCA301_IMPL CRC16_PCA301_IMPL_BITWISE
+namespace crc16_bench_bitwise {
+#include "crc16_pca301.cpp"
+}
+
+#undef CRC16_PCA301_IMPL
+#define CRC16_PCA301_IMPL CRC16_PCA301_IMPL_NIBBLE
+namespace crc16_bench_nibble {
+#include "crc16_pca301.cpp"
+}
+
+#undef CRC16_PCA301_IMPL
+#define CRC16_PCA301_IMPL CRC16_PCA301_IMPL_TABLE
+namespace crc16_bench_table {
+#include "crc16_pca301.cpp"
+}
+
+
+/*****************************************************************************/
+/* Local defines */
+/*****************************************************************************/
+#define CRC16_BENCH_FRAME_LEN                       (PCA_PAYLOAD_LEN - 2)
+#define CRC16_BENCH_POOL                            256
+
+
+/*****************************************************************************/
+/* Local structures */
+/*****************************************************************************/
+struct crc16_bench_impl {
+    const char *name;                           /**< implementation name */
+    unsigned int flash;                         /**< table size in bytes */
+    uint16_t (*crc)(const uint8_t *, uint16_t); /**< CRC of a data block */
+};
+
+
+/*****************************************************************************/
+/* Local variables */
+/*****************************************************************************/
+static const struct crc16_bench_impl crc16_bench_impls[] = {
+    { "bitwise", 0, crc16_bench_bitwise::crc16_pca301 },
+    { "nibble", 16 * sizeof(uint16_t), crc16_bench_nibble::crc16_pca301 },
+    { "table", 256 * sizeof(uint16_t), crc16_bench_table::crc16_pca301 },
+};
+
+static uint8_t crc16_bench_pool[CRC16_BENCH_POOL][CRC16_BENCH_FRAME_LEN]; /**< random frames */
+
+
+/*****************************************************************************/
+/** Monotonic Host Time In Nanoseconds
+ */
+static uint64_t crc16_bench_ns(
+    void
+)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+/*****************************************************************************/
+/** Time All CRC16 Implementations
+ *
+ * Prints one line per implementation to stdout.
+ *
+ * @returns false if the implementations disagree
+ */
+bool crc16_bench_run(
+    unsigned int frames                         /**< frames per implementation */
+)
+{
+    uint16_t ref[CRC16_BENCH_POOL];
+    uint16_t sum;
+    uint64_t ns;
+    unsigned int impl;
+    unsigned int cnt;
+    unsigned int pos;
+
+    srand(1);
+    for (cnt = 0; cnt < CRC16_BENCH_POOL; cnt++) {
+        for (pos = 0; pos < CRC16_BENCH_FRAME_LEN; pos++) {
+            crc16_bench_pool[cnt][pos] = rand();
+        }
+        ref[cnt] = crc16_bench_bitwise::crc16_pca301(crc16_bench_pool[cnt], CRC16_BENCH_FRAME_LEN);
+    }
+
+    for (impl = 0; impl < sizeof(crc16_bench_impls) / sizeof(crc16_bench_impls[0]); impl++) {
+        for (cnt = 0; cnt < CRC16_BENCH_POOL; cnt++) {
+            if (ref[cnt] != crc16_bench_impls[impl].crc(crc16_bench_pool[cnt], CRC16_BENCH_FRAME_LEN)) {
+                fprintf(stderr, "crc16 %s disagrees on frame %u\n", crc16_bench_impls[impl].name, cnt);
+                return false;
+            }
+        }
+    }
+
+    printf("crc16 frames %u len %u\n", frames, CRC16_BENCH_FRAME_LEN);
+    for (impl = 0; impl < sizeof(crc16_bench_impls) / sizeof(crc16_bench_impls[0]); impl++) {
+        /* the sum keeps the compiler from dropping the calls */
+        sum = 0;
+        ns = crc16_bench_ns();
+        for (cnt = 0; cnt < frames; cnt++) {
+            sum += crc16_bench_impls[impl].crc(crc16_bench_pool[cnt % CRC16_BENCH_POOL], CRC16_BENCH_FRAME_LEN);
+        }
+        ns = crc16_bench_ns() - ns;
+
+        printf("crc16 %-7s flash %3u ns/frame %.1f ns/byte %.2f sum %04x\n",
+               crc16_bench_impls[impl].name, crc16_bench_impls[impl].flash,
+               (double) ns / frames, (double) ns / frames / CRC16_BENCH_FRAME_LEN, sum);
+    }
+
+    return true;
+}
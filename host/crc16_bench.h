@@ -0,0 +1,25 @@
+/**
+ * @brief Timing Of The CRC16 Implementations
+ *
+ * Builds crc16_pca301.cpp once per CRC16_PCA301_IMPL_* value and times each
+ * variant over PCA301 frames on the host CPU.
+ *
+ * Copyright (c) 2017, Sven Bachmann <dev@mcbachmann.de>
+ *
+ * Licensed under the MIT license, see LICENSE for details.
+ */
+#ifndef CRC16_BENCH_H
+#define CRC16_BENCH_H
+
+#include <stdbool.h>
+
+
+/*****************************************************************************/
+/* Prototypes */
+/*****************************************************************************/
+bool crc16_bench_run(
+    unsigned int frames                         /**< frames per implementation */
+);
+
+
+#endif /* CRC16_BENCH_H */
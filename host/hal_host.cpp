@@ -0,0 +1,811 @@
+/**
+ * @brief Hardware Abstraction Layer - Host Implementation
+ *
+ * The RFM69 is replaced by the register-level simulator in rfm69_sim.cpp, the
+ * serial port by the process stdout and a scripted input queue and the EEPROM
+ * by a RAM image that can be loaded from and stored to a file.
+ *
+ * Copyright (c) 2017, Sven Bachmann <dev@mcbachmann.de>
+ *
+ * Licensed under the MIT license, see LICENSE for details.
+ */
+#include <vector>
+#include "hal.h"
+#include "hal_host.h"
+#include "rfm69_sim.h"
+
+
+/*****************************************************************************/
+/* Local defines */
+/*****************************************************************************/
+#define HOST_COST_GPIO_NS                           3500    /**< digitalWrite */
+#define HOST_COST_SPI_BYTE_NS                       2500    /**< 8 bit @ 4 MHz + overhead */
+#define HOST_COST_MILLIS_NS                         500     /**< millis() */
+#define HOST_COST_SERIAL_CALL_NS                    1000    /**< Serial.available/read */
+#define HOST_COST_SERIAL_BYTE_NS                    6000    /**< Serial.write into buffer */
+#define HOST_COST_EEPROM_BYTE_NS                    3400000 /**< EEPROM byte write */
+#define HOST_COST_EEPROM_READ_NS                    1000    /**< EEPROM byte read */
+
+#define HOST_SERIAL_BYTE_NS                         (10ULL * 1000000000ULL / 57600)
+#define HOST_SERIAL_BUF_SIZE                        64
+#define HOST_RADIO_NONE                             0xff
+
+
+/*****************************************************************************/
+/* Local structures */
+/*****************************************************************************/
+struct host_radio_pins {
+    uint8_t pin_ss;                             /**< slave select pin */
+    uint8_t pin_irq;                            /**< DIO0 interrupt pin */
+};
+
+struct host_serial_in {
+    uint64_t at_ns;                             /**< arrival time */
+    char c;                                     /**< character */
+};
+
+
+/*****************************************************************************/
+/* Local variables */
+/*****************************************************************************/
+static uint64_t host_now_ns;                    /**< virtual clock */
+static const struct host_radio_pins host_radio_pins[RFM69_SIM_RADIOS] = {
+    { 10, 2 },
+    { 8, 3 },
+};                                              /**< simulated radio wiring */
+static uint8_t host_spi_radio = HOST_RADIO_NONE; /**< selected radio */
+static void (*host_irq_handler[RFM69_SIM_RADIOS])(void); /**< attached handlers */
+static bool host_dio0[RFM69_SIM_RADIOS];        /**< last DIO0 levels */
+static bool host_in_irq;                        /**< handler running */
+static std::vector<struct host_serial_in> host_serial_in; /**< scripted input */
+static size_t host_serial_in_pos;               /**< next input byte */
+static char host_serial_rx[HOST_SERIAL_BUF_SIZE]; /**< serial RX buffer */
+static uint64_t host_serial_rx_ts[HOST_SERIAL_BUF_SIZE]; /**< arrival of buffered bytes */
+static unsigned int host_serial_rx_head;        /**< RX buffer read pos */
+static unsigned int host_serial_rx_cnt;         /**< RX buffer fill level */
+static uint64_t host_serial_tx_level_ns;        /**< pending TX buffer time */
+static uint64_t host_serial_tx_ts_ns;           /**< last TX buffer update */
+static FILE *host_serial_out = stdout;          /**< serial output stream */
+static void (*host_serial_out_hook)(uint8_t c); /**< serial output hook */
+static uint8_t host_eeprom[HAL_EEPROM_SIZE]; /**< EEPROM image */
+static uint32_t host_eeprom_cnt[HAL_EEPROM_SIZE]; /**< EEPROM cell writes */
+static bool host_eeprom_init;                   /**< EEPROM initialized */
+static const uint8_t *host_eeprom_src;          /**< background write source */
+static uint16_t host_eeprom_addr;               /**< background write address */
+static uint16_t host_eeprom_len;                /**< bytes left to write */
+static bool host_eeprom_cell_busy;              /**< byte write running */
+static uint64_t host_eeprom_ready_ns;           /**< end of running byte write */
+static struct hal_host_stats host_stats;        /**< statistics */
+
+
+/*****************************************************************************/
+/** Move Arrived Serial Input Into RX Buffer
+ */
+static void host_serial_rx_update(
+    void
+)
+{
+    while ((host_serial_in_pos < host_serial_in.size())
+           && (host_serial_in[host_serial_in_pos].at_ns <= host_now_ns)) {
+
+        if (HOST_SERIAL_BUF_SIZE > host_serial_rx_cnt) {
+            host_serial_rx[(host_serial_rx_head + host_serial_rx_cnt) % HOST_SERIAL_BUF_SIZE] =
+                host_serial_in[host_serial_in_pos].c;
+            host_serial_rx_ts[(host_serial_rx_head + host_serial_rx_cnt) % HOST_SERIAL_BUF_SIZE] =
+                host_serial_in[host_serial_in_pos].at_ns;
+            host_serial_rx_cnt++;
+        } else {
+            host_stats.serial_rx_overflow++;
+        }
+        host_serial_in_pos++;
+    }
+}
+
+
+/*****************************************************************************/
+/** Radio Wired To A Slave Select Or Interrupt Pin
+ */
+static uint8_t host_radio_find(
+    uint8_t pin,                                /**< pin number */
+    bool irq                                    /**< pin is an interrupt pin */
+)
+{
+    uint8_t radio;
+
+    for (radio = 0; radio < RFM69_SIM_RADIOS; radio++) {
+        if (pin == ((irq) ? host_radio_pins[radio].pin_irq : host_radio_pins[radio].pin_ss)) {
+            return radio;
+        }
+    }
+
+    return HOST_RADIO_NONE;
+}
+
+
+/*****************************************************************************/
+/** Simulated Radio Behind A Slave Select Pin
+ *
+ * Returns 0xff if no radio is wired to the pin.
+ */
+uint8_t hal_host_radio(
+    uint8_t pin_ss                              /**< slave select pin */
+)
+{
+    return host_radio_find(pin_ss, false);
+}
+
+
+/*****************************************************************************/
+/** Current Virtual Time
+ */
+uint64_t hal_host_time_ns(
+    void
+)
+{
+    return host_now_ns;
+}
+
+
+/*****************************************************************************/
+/** Write EEPROM Cell And Count Wear
+ */
+static void host_eeprom_cell_write(
+    uint16_t addr,                              /**< EEPROM address */
+    uint8_t val                                 /**< value */
+)
+{
+    host_eeprom[addr] = val;
+    host_eeprom_cnt[addr]++;
+    if (host_eeprom_cnt[addr] > host_stats.eeprom_cell_max) {
+        host_stats.eeprom_cell_max = host_eeprom_cnt[addr];
+    }
+    host_stats.eeprom_writes++;
+}
+
+
+/*****************************************************************************/
+/** EEPROM Ready Interrupt Model
+ *
+ * Like the ISR on the AVR, unchanged bytes are skipped and each changed one
+ * takes a full cell write time before the next one starts. With flush set
+ * the remaining bytes are written at once.
+ */
+static void host_eeprom_async_run(
+    bool flush                                  /**< ignore write time */
+)
+{
+    while (host_eeprom_len) {
+        if (host_eeprom_cell_busy) {
+            if (!flush && (host_now_ns < host_eeprom_ready_ns)) {
+                return;
+            }
+            host_eeprom_cell_write(host_eeprom_addr, *host_eeprom_src);
+            host_eeprom_cell_busy = false;
+        } else if ((host_eeprom_addr < HAL_EEPROM_SIZE) && (host_eeprom[host_eeprom_addr] != *host_eeprom_src)) {
+            host_eeprom_cell_busy = true;
+            host_eeprom_ready_ns += HOST_COST_EEPROM_BYTE_NS;
+            continue;
+        }
+
+        host_eeprom_src++;
+        host_eeprom_addr++;
+        host_eeprom_len--;
+    }
+}
+
+
+/*****************************************************************************/
+/** Dispatch EEPROM Ready Interrupt
+ */
+static void host_eeprom_tick(
+    void
+)
+{
+    if (host_eeprom_len) {
+        host_eeprom_async_run(false);
+    }
+}
+
+
+/*****************************************************************************/
+/** Advance Virtual Time
+ *
+ * Updates the radio simulation and dispatches the DIO0 interrupts on a rising
+ * edge.
+ */
+void hal_host_advance_ns(
+    uint64_t ns                                 /**< time to pass */
+)
+{
+    uint8_t radio;
+    bool dio0;
+
+    host_now_ns += ns;
+    rfm69_sim_tick(host_now_ns / 1000);
+    host_eeprom_tick();
+
+    for (radio = 0; radio < RFM69_SIM_RADIOS; radio++) {
+        dio0 = rfm69_sim_dio0(radio);
+        if (dio0 && !host_dio0[radio] && host_irq_handler[radio] && !host_in_irq) {
+            host_in_irq = true;
+            host_stats.irqs++;
+            host_irq_handler[radio]();
+            host_in_irq = false;
+        }
+        host_dio0[radio] = dio0;
+    }
+}
+
+
+/*****************************************************************************/
+/** Queue Serial Input
+ *
+ * The bytes arrive one after another at the configured line speed.
+ */
+void hal_host_serial_input(
+    uint64_t at_ns,                             /**< arrival of first byte */
+    const char *data,                           /**< data */
+    unsigned int len                            /**< data length */
+)
+{
+    struct host_serial_in in;
+
+    if (!host_serial_in.empty() && (host_serial_in.back().at_ns >= at_ns)) {
+        at_ns = host_serial_in.back().at_ns + HOST_SERIAL_BYTE_NS;
+    }
+
+    for (; len; len--, data++, at_ns += HOST_SERIAL_BYTE_NS) {
+        in.at_ns = at_ns;
+        in.c = *data;
+        host_serial_in.push_back(in);
+    }
+}
+
+
+/*****************************************************************************/
+/** Serial Input Still Pending
+ */
+bool hal_host_serial_input_pending(
+    void
+)
+{
+    return (host_serial_in_pos < host_serial_in.size()) || host_serial_rx_cnt;
+}
+
+
+/*****************************************************************************/
+/** Select Serial Output Stream
+ */
+void hal_host_serial_output(
+    FILE *out                                   /**< output stream or NULL */
+)
+{
+    host_serial_out = out;
+}
+
+
+/*****************************************************************************/
+/** Pass Serial Output To A Hook Instead Of The Stream
+ */
+void hal_host_serial_output_hook(
+    void (*hook)(uint8_t c)                     /**< output hook or NULL */
+)
+{
+    host_serial_out_hook = hook;
+}
+
+
+/*****************************************************************************/
+/** Initialize EEPROM Image
+ */
+static void host_eeprom_prepare(
+    void
+)
+{
+    if (!host_eeprom_init) {
+        memset(host_eeprom, 0xff, sizeof(host_eeprom));
+        host_eeprom_init = true;
+    }
+}
+
+
+/*****************************************************************************/
+/** Load EEPROM Image
+ */
+bool hal_host_eeprom_load(
+    const char *path                            /**< image path */
+)
+{
+    FILE *f;
+
+    host_eeprom_prepare();
+
+    f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    if (!fread(host_eeprom, 1, sizeof(host_eeprom), f)) {
+        memset(host_eeprom, 0xff, sizeof(host_eeprom));
+    }
+    fclose(f);
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/** Store EEPROM Image
+ */
+bool hal_host_eeprom_save(
+    const char *path                            /**< image path */
+)
+{
+    FILE *f;
+    bool ret;
+
+    host_eeprom_prepare();
+
+    /* background writes finish before power is lost */
+    host_eeprom_async_run(true);
+
+    f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    ret = (sizeof(host_eeprom) == fwrite(host_eeprom, 1, sizeof(host_eeprom), f));
+    fclose(f);
+
+    return ret;
+}
+
+
+/*****************************************************************************/
+/** Get Statistics
+ */
+const struct hal_host_stats * hal_host_stats_get(
+    void
+)
+{
+    return &host_stats;
+}
+
+
+/*****************************************************************************/
+/** SPI Initialization
+ */
+void hal_spi_init(
+    uint8_t pin_ss                              /**< slave select pin */
+)
+{
+    uint8_t radio = host_radio_find(pin_ss, false);
+
+    if (HOST_RADIO_NONE != radio) {
+        rfm69_sim_reset(radio);
+    }
+}
+
+
+/*****************************************************************************/
+/** SPI Select Slave
+ */
+void hal_spi_select(
+    uint8_t pin_ss                              /**< slave select pin */
+)
+{
+    hal_host_advance_ns(HOST_COST_GPIO_NS);
+    host_spi_radio = host_radio_find(pin_ss, false);
+    if (HOST_RADIO_NONE != host_spi_radio) {
+        rfm69_sim_select(host_spi_radio);
+    }
+}
+
+
+/*****************************************************************************/
+/** SPI Deselect Slave
+ */
+void hal_spi_deselect(
+    uint8_t pin_ss                              /**< slave select pin */
+)
+{
+    if ((HOST_RADIO_NONE != host_spi_radio) && (host_radio_find(pin_ss, false) == host_spi_radio)) {
+        rfm69_sim_deselect(host_spi_radio);
+        host_spi_radio = HOST_RADIO_NONE;
+    }
+    hal_host_advance_ns(HOST_COST_GPIO_NS);
+}
+
+
+/*****************************************************************************/
+/** SPI Transfer Byte
+ */
+uint8_t hal_spi_transfer(
+    uint8_t val                                 /**< value to send */
+)
+{
+    uint8_t ret = 0xff;
+
+    if (HOST_RADIO_NONE != host_spi_radio) {
+        ret = rfm69_sim_transfer(host_spi_radio, val);
+    }
+    hal_host_advance_ns(HOST_COST_SPI_BYTE_NS);
+
+    return ret;
+}
+
+
+/*****************************************************************************/
+/** GPIO Configure Output
+ */
+void hal_gpio_output(
+    uint8_t pin                                 /**< pin number */
+)
+{
+    (void) pin;
+}
+
+
+/*****************************************************************************/
+/** GPIO Configure Input
+ */
+void hal_gpio_input(
+    uint8_t pin                                 /**< pin number */
+)
+{
+    (void) pin;
+}
+
+
+/*****************************************************************************/
+/** GPIO Write
+ */
+void hal_gpio_write(
+    uint8_t pin,                                /**< pin number */
+    bool high                                   /**< output level */
+)
+{
+    (void) pin;
+    (void) high;
+    hal_host_advance_ns(HOST_COST_GPIO_NS);
+}
+
+
+/*****************************************************************************/
+/** Milliseconds Since Start
+ */
+unsigned long hal_millis(
+    void
+)
+{
+    hal_host_advance_ns(HOST_COST_MILLIS_NS);
+    return (unsigned long) (host_now_ns / 1000000);
+}
+
+
+/*****************************************************************************/
+/** Delay in Milliseconds
+ */
+void hal_delay_ms(
+    unsigned long ms                            /**< delay in milliseconds */
+)
+{
+    uint64_t end = host_now_ns + (uint64_t) ms * 1000000;
+
+    /* pass time in small steps so interrupts are dispatched in time */
+    while (host_now_ns < end) {
+        hal_host_advance_ns(10000);
+    }
+}
+
+
+/*****************************************************************************/
+/** Random Number
+ */
+long hal_random(
+    long min,                                   /**< lower bound */
+    long max                                    /**< upper bound (exclusive) */
+)
+{
+    if (max <= min) {
+        return min;
+    }
+    return min + (rand() % (max - min));
+}
+
+
+/*****************************************************************************/
+/** Attach Interrupt Handler
+ */
+void hal_irq_attach(
+    uint8_t pin,                                /**< interrupt pin */
+    void (*handler)(void),                      /**< interrupt handler */
+    uint8_t mode                                /**< trigger mode */
+)
+{
+    uint8_t radio = host_radio_find(pin, true);
+
+    (void) mode;
+    if (HOST_RADIO_NONE != radio) {
+        host_irq_handler[radio] = handler;
+    }
+}
+
+
+/*****************************************************************************/
+/** Detach Interrupt Handler
+ */
+void hal_irq_detach(
+    uint8_t pin                                 /**< interrupt pin */
+)
+{
+    uint8_t radio = host_radio_find(pin, true);
+
+    if (HOST_RADIO_NONE != radio) {
+        host_irq_handler[radio] = NULL;
+    }
+}
+
+
+/*****************************************************************************/
+/** Serial Initialization
+ */
+void hal_serial_init(
+    unsigned long bps                           /**< speed in bits/s */
+)
+{
+    (void) bps;
+}
+
+
+/*****************************************************************************/
+/** Serial Ready
+ */
+bool hal_serial_ready(
+    void
+)
+{
+    return true;
+}
+
+
+/*****************************************************************************/
+/** Serial Bytes Available
+ */
+int hal_serial_available(
+    void
+)
+{
+    hal_host_advance_ns(HOST_COST_SERIAL_CALL_NS);
+    host_serial_rx_update();
+
+    return host_serial_rx_cnt;
+}
+
+
+/*****************************************************************************/
+/** Serial Read Byte
+ */
+int hal_serial_read(
+    void
+)
+{
+    char c;
+    uint64_t wait;
+
+    hal_host_advance_ns(HOST_COST_SERIAL_CALL_NS);
+    host_serial_rx_update();
+
+    if (!host_serial_rx_cnt) {
+        return -1;
+    }
+
+    c = host_serial_rx[host_serial_rx_head];
+    wait = host_now_ns - host_serial_rx_ts[host_serial_rx_head];
+    host_serial_rx_head = (host_serial_rx_head + 1) % HOST_SERIAL_BUF_SIZE;
+    host_serial_rx_cnt--;
+    host_stats.serial_rx_bytes++;
+    host_stats.serial_rx_wait_ns += wait;
+    if (wait > host_stats.serial_rx_wait_max_ns) {
+        host_stats.serial_rx_wait_max_ns = wait;
+    }
+
+    return (unsigned char) c;
+}
+
+
+/*****************************************************************************/
+/** Serial TX Buffer Space
+ *
+ * Number of bytes that can be printed without blocking.
+ */
+int hal_serial_tx_free(
+    void
+)
+{
+    uint64_t elapsed;
+    uint64_t level;
+
+    hal_host_advance_ns(HOST_COST_SERIAL_CALL_NS);
+
+    elapsed = host_now_ns - host_serial_tx_ts_ns;
+    level = (elapsed < host_serial_tx_level_ns) ? host_serial_tx_level_ns - elapsed : 0;
+
+    return HOST_SERIAL_BUF_SIZE - (int) ((level + HOST_SERIAL_BYTE_NS - 1) / HOST_SERIAL_BYTE_NS);
+}
+
+
+/*****************************************************************************/
+/** Serial Write Byte
+ *
+ * Blocks (in virtual time) while the hardware TX buffer is full.
+ */
+static void host_serial_write(
+    char c                                      /**< character */
+)
+{
+    uint64_t elapsed;
+    uint64_t wait;
+
+    /* drain TX buffer */
+    elapsed = host_now_ns - host_serial_tx_ts_ns;
+    host_serial_tx_level_ns = (elapsed < host_serial_tx_level_ns) ? host_serial_tx_level_ns - elapsed : 0;
+    host_serial_tx_ts_ns = host_now_ns;
+
+    /* block until there is room for one byte */
+    if (host_serial_tx_level_ns >= HOST_SERIAL_BUF_SIZE * HOST_SERIAL_BYTE_NS) {
+        wait = host_serial_tx_level_ns - (HOST_SERIAL_BUF_SIZE - 1) * HOST_SERIAL_BYTE_NS;
+        host_stats.serial_tx_block_ns += wait;
+        hal_host_advance_ns(wait);
+        host_serial_tx_level_ns -= wait;
+        host_serial_tx_ts_ns = host_now_ns;
+    }
+
+    host_serial_tx_level_ns += HOST_SERIAL_BYTE_NS;
+    host_stats.serial_tx_bytes++;
+    hal_host_advance_ns(HOST_COST_SERIAL_BYTE_NS);
+
+    if (host_serial_out_hook) {
+        host_serial_out_hook(c);
+    } else if (host_serial_out) {
+        fputc(c, host_serial_out);
+    }
+}
+
+
+/*****************************************************************************/
+/** Serial Print String
+ */
+void hal_serial_print(
+    const char *str                             /**< string */
+)
+{
+    while (*str) {
+        host_serial_write(*str++);
+    }
+}
+
+
+/*****************************************************************************/
+/** Serial Print Character
+ */
+void hal_serial_print_char(
+    char c                                      /**< character */
+)
+{
+    host_serial_write(c);
+}
+
+
+/*****************************************************************************/
+/** Serial Print Decimal Value
+ */
+void hal_serial_print_dec(
+    uint32_t val                                /**< value */
+)
+{
+    char buf[11];
+
+    snprintf(buf, sizeof(buf), "%lu", (unsigned long) val);
+    hal_serial_print(buf);
+}
+
+
+/*****************************************************************************/
+/** Serial Print Newline
+ */
+void hal_serial_println(
+    void
+)
+{
+    host_serial_write('\r');
+    host_serial_write('\n');
+}
+
+
+/*****************************************************************************/
+/** EEPROM Read Block
+ */
+void hal_eeprom_read_block(
+    void *dst,                                  /**< destination buffer */
+    uint16_t addr,                              /**< EEPROM address */
+    uint16_t len                                /**< length */
+)
+{
+    uint8_t *ptr = (uint8_t *) dst;
+
+    host_eeprom_prepare();
+
+    while (hal_eeprom_busy()) {
+        hal_host_advance_ns(10000);
+    }
+
+    for (; len; len--, addr++, ptr++) {
+        *ptr = (addr < HAL_EEPROM_SIZE) ? host_eeprom[addr] : 0xff;
+        hal_host_advance_ns(HOST_COST_EEPROM_READ_NS);
+    }
+}
+
+
+/*****************************************************************************/
+/** EEPROM Write Block
+ */
+void hal_eeprom_write_block(
+    const void *src,                            /**< source buffer */
+    uint16_t addr,                              /**< EEPROM address */
+    uint16_t len                                /**< length */
+)
+{
+    const uint8_t *ptr = (const uint8_t *) src;
+
+    host_eeprom_prepare();
+
+    while (hal_eeprom_busy()) {
+        host_stats.eeprom_block_ns += 10000;
+        hal_host_advance_ns(10000);
+    }
+
+    for (; len; len--, addr++, ptr++) {
+        if (addr >= HAL_EEPROM_SIZE) {
+            continue;
+        }
+
+        host_eeprom_cell_write(addr, *ptr);
+        host_stats.eeprom_block_ns += HOST_COST_EEPROM_BYTE_NS;
+        hal_host_advance_ns(HOST_COST_EEPROM_BYTE_NS);
+    }
+}
+
+
+/*****************************************************************************/
+/** EEPROM Write Block In Background
+ */
+bool hal_eeprom_write_async(
+    const void *src,                            /**< source buffer, kept until done */
+    uint16_t addr,                              /**< EEPROM address */
+    uint16_t len                                /**< length */
+)
+{
+    host_eeprom_prepare();
+
+    if (hal_eeprom_busy()) {
+        return false;
+    }
+
+    host_eeprom_src = (const uint8_t *) src;
+    host_eeprom_addr = addr;
+    host_eeprom_len = len;
+    host_eeprom_ready_ns = host_now_ns;
+    host_eeprom_async_run(false);
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/** EEPROM Background Write Pending
+ */
+bool hal_eeprom_busy(
+    void
+)
+{
+    return host_eeprom_len;
+}
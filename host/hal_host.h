@@ -0,0 +1,83 @@
+/**
+ * @brief Hardware Abstraction Layer - Host Implementation
+ *
+ * Runs the firmware against a virtual clock. Every HAL access advances the
+ * clock by a rough estimate of what the same operation costs on an Arduino
+ * Nano (16 MHz, 4 MHz SPI, 57600 bps serial) so loop timings reported by the
+ * host build are comparable between firmware versions.
+ *
+ * Copyright (c) 2017, Sven Bachmann <dev@mcbachmann.de>
+ *
+ * Licensed under the MIT license, see LICENSE for details.
+ */
+#ifndef HAL_HOST_H
+#define HAL_HOST_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+
+/*****************************************************************************/
+/* Structures */
+/*****************************************************************************/
+struct hal_host_stats {
+    uint32_t serial_tx_bytes;                   /**< bytes printed */
+    uint64_t serial_tx_block_ns;                /**< time blocked on full TX buffer */
+    uint32_t serial_rx_bytes;                   /**< bytes read by firmware */
+    uint32_t serial_rx_overflow;                /**< bytes lost on full RX buffer */
+    uint64_t serial_rx_wait_ns;                 /**< sum of byte arrival to read */
+    uint64_t serial_rx_wait_max_ns;             /**< longest byte arrival to read */
+    uint32_t eeprom_writes;                     /**< bytes written to EEPROM */
+    uint32_t eeprom_cell_max;                   /**< max writes of a single cell */
+    uint64_t eeprom_block_ns;                   /**< time blocked on EEPROM writes */
+    uint32_t irqs;                              /**< dispatched interrupts */
+};
+
+
+/*****************************************************************************/
+/* Prototypes */
+/*****************************************************************************/
+uint64_t hal_host_time_ns(
+    void
+);
+
+void hal_host_advance_ns(
+    uint64_t ns                                 /**< time to pass */
+);
+
+uint8_t hal_host_radio(
+    uint8_t pin_ss                              /**< slave select pin */
+);
+
+void hal_host_serial_input(
+    uint64_t at_ns,                             /**< arrival of first byte */
+    const char *data,                           /**< data */
+    unsigned int len                            /**< data length */
+);
+
+bool hal_host_serial_input_pending(
+    void
+);
+
+void hal_host_serial_output(
+    FILE *out                                   /**< output stream or NULL */
+);
+
+void hal_host_serial_output_hook(
+    void (*hook)(uint8_t c)                     /**< output hook or NULL */
+);
+
+bool hal_host_eeprom_load(
+    const char *path                            /**< image path */
+);
+
+bool hal_host_eeprom_save(
+    const char *path                            /**< image path */
+);
+
+const struct hal_host_stats * hal_host_stats_get(
+    void
+);
+
+
+#endif /* HAL_HOST_H */
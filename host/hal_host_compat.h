@@ -0,0 +1,37 @@
+/**
+ * @brief Hardware Abstraction Layer - Host Compatibility Definitions
+ *
+ * Provides the few Arduino types and helpers the firmware uses besides the
+ * HAL functions so the sketch sources can be compiled on the host.
+ *
+ * Copyright (c) 2017, Sven Bachmann <dev@mcbachmann.de>
+ *
+ * Licensed under the MIT license, see LICENSE for details.
+ */
+#ifndef HAL_HOST_COMPAT_H
+#define HAL_HOST_COMPAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/*****************************************************************************/
+/* Arduino Compatibility */
+/*****************************************************************************/
+typedef uint8_t byte;
+
+#define PROGMEM
+#define PGM_P                                       const char *
+#define pgm_read_byte(addr)                         (*(const uint8_t *) (addr))
+#define pgm_read_word(addr)                         (*(const uint16_t *) (addr))
+
+#ifndef E2END
+#  define E2END                                     0x3ff   /**< ATmega328P */
+#endif
+
+#define constrain(val, lo, hi)                      ((val) < (lo) ? (lo) : ((val) > (hi) ? (hi) : (val)))
+
+
+#endif /* HAL_HOST_COMPAT_H */
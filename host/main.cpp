@@ -0,0 +1,1145 @@
+/**
+ * @brief PCA301 Serial Firmware - Linux Host Build
+ *
+ * Runs the unmodified firmware (setup/loop) against the simulated RFM69 and a
+ * set of simulated PCA301 outlets that answer polls and switch commands.
+ *
+ * Serial input is read from stdin. A line starting with '@' followed by a
+ * number in milliseconds delays the following input to that virtual time.
+ * Example:
+ *
+ *   printf '1p\n@2000\n2e\n' | ./pca301serial_host -t 5 -s
+ *
+ * Copyright (c) 2017, Sven Bachmann <dev@mcbachmann.de>
+ *
+ * Licensed under the MIT license, see LICENSE for details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "hal.h"
+#include "crc16_pca301.h"
+#include "funky_rfm69.h"
+#include "pca301_rfm69.h"
+#include "hal_host.h"
+#include "rfm69_sim.h"
+#include "pca301_bin.h"
+#include "crc16_bench.h"
+
+#if !PCA_STATS
+#  error "the host statistics need PCA_STATS=1"
+#endif
+
+
+/*****************************************************************************/
+/* Local defines */
+/*****************************************************************************/
+#define HOST_OUTLETS_MAX                            256
+#define HOST_OUTLET_REPLY_DELAY_US                  5000
+#define HOST_OUTLET_RSSI                            0x60
+#define HOST_DISPLAY_RSSI                           0x50
+#define HOST_DISPLAY_REPEAT_GAP_US                  2000
+#define HOST_LOCAL_RSSI                             0x20
+#define HOST_PAIR_WINDOW_FRAMES                     3
+#define HOST_LOOKUP_TIMEOUT_US                      200000
+
+
+/*****************************************************************************/
+/* Local structures */
+/*****************************************************************************/
+struct host_outlet {
+    uint32_t dev_id;                            /**< device id */
+    uint8_t channel;                            /**< paired channel */
+    uint8_t state;                              /**< relay state */
+    uint16_t p_now;                             /**< current power */
+    uint16_t p_load;                            /**< power while switched on */
+    uint16_t p_ttl;                             /**< total consumption */
+    uint32_t polls;                             /**< polls received */
+    uint64_t first_poll_us;                     /**< time of first poll */
+    uint32_t answers;                           /**< replies received by the node */
+    uint64_t first_answer_us;                   /**< time of first received reply */
+};
+
+
+/*****************************************************************************/
+/* Local variables */
+/*****************************************************************************/
+static struct host_outlet host_outlets[HOST_OUTLETS_MAX]; /**< simulated outlets */
+static unsigned int host_outlets_cnt = 2;       /**< outlet count */
+static uint64_t host_display_period_us;         /**< display unit poll period */
+static uint64_t host_display_next_us;           /**< next display unit poll */
+static unsigned int host_display_outlet;        /**< next outlet to poll */
+static uint64_t host_repair_period_us;          /**< period of channel changes */
+static uint64_t host_repair_next_us;            /**< next channel change */
+static unsigned int host_repair_outlet;         /**< next outlet to change */
+static uint64_t host_setup_ns;                  /**< duration of setup() */
+static uint32_t host_setup_spi;                 /**< SPI transactions in setup() */
+static uint64_t host_pair_us;                   /**< time of the pairing request, 0 = none */
+static struct host_outlet *host_pair_outlet;    /**< outlet asking to be paired */
+static uint64_t host_pair_end_us;               /**< end of the pairing request on air */
+static uint64_t host_pair_answer_us;            /**< end of the pairing answer, 0 = none */
+static uint32_t host_pair_window_rx;            /**< frames received before the answer */
+static uint64_t host_input_done_ns;             /**< all serial input consumed */
+static struct pca301_bin host_bin;              /**< decoder of binary output */
+static unsigned int host_load_noise;            /**< power fluctuation in percent of the load */
+static bool host_quiet;                         /**< serial output suppressed */
+static uint32_t host_lookup_ids[PCA_MAXDEV];    /**< devIds learned by the lookup scenario */
+static uint64_t host_link_down_us;              /**< serial link drop, 0 = none */
+static uint64_t host_link_up_us;                /**< serial link back */
+static bool host_link_resumed;                  /**< resume command sent */
+static void (*host_link_next)(uint8_t c);       /**< receiver behind the link */
+static char host_link_line[128];                /**< line being received */
+static unsigned int host_link_len;              /**< bytes in line, beyond size = discard */
+static long host_link_seq = -1;                 /**< last F line sequence number, -1 = none */
+static uint32_t host_link_readings;             /**< F lines with a new sequence number */
+static uint32_t host_link_dups;                 /**< F lines seen before */
+static uint32_t host_link_missing;              /**< sequence numbers skipped without #LOST */
+static uint32_t host_link_lost;                 /**< readings announced as lost */
+static uint32_t host_link_ok;                   /**< plain OK lines received */
+static const char *host_txq_class[PCA_TX_CLASSES] = { "switch", "pair", "poll" }; /**< TX queue class names */
+
+
+/*****************************************************************************/
+/* Firmware entry points */
+/*****************************************************************************/
+void setup(
+    void
+);
+
+void loop(
+    void
+);
+
+
+/*****************************************************************************/
+/** Put Frame On Air For All Radios Except The Sender
+ */
+static void host_air_schedule(
+    uint64_t end_us,                            /**< end of transmission */
+    const uint8_t *frame,                       /**< frame */
+    uint8_t len,                                /**< frame length */
+    uint8_t rssi,                               /**< RSSI value */
+    uint8_t sender                              /**< sending radio or RFM69_SIM_RADIOS */
+)
+{
+    uint8_t radio;
+
+    for (radio = 0; radio < RFM69_SIM_RADIOS; radio++) {
+        if (radio != sender) {
+            rfm69_sim_rx_schedule(radio, end_us, frame, len, rssi);
+        }
+    }
+}
+
+
+/*****************************************************************************/
+/** Build PCA301 Frame And Schedule It For Reception
+ */
+static void host_frame_schedule(
+    uint64_t at_us,                             /**< start of transmission */
+    uint8_t *frame,                             /**< 12 byte frame, CRC is added */
+    uint8_t rssi                                /**< RSSI value */
+)
+{
+    uint16_t crc;
+
+    crc = crc16_pca301(frame, 10);
+    frame[10] = crc >> 8;
+    frame[11] = crc;
+
+    host_air_schedule(at_us + rfm69_sim_airtime_us(0, 12), frame, 12, rssi, RFM69_SIM_RADIOS);
+}
+
+
+/*****************************************************************************/
+/** Outlet Model: Answer Command
+ */
+static void host_outlet_reply(
+    struct host_outlet *outlet,                 /**< outlet */
+    uint8_t cmd,                                /**< command to answer */
+    uint64_t at_us                              /**< start of transmission */
+)
+{
+    uint8_t reply[12];
+    int range;
+
+    /* the load wanders around its nominal power from reply to reply */
+    if (host_load_noise && outlet->state) {
+        range = outlet->p_load * host_load_noise / 100;
+        outlet->p_now = outlet->p_load + rand() % (2 * range + 1) - range;
+    }
+
+    reply[0] = outlet->channel;
+    reply[1] = cmd;
+    reply[2] = outlet->dev_id >> 16;
+    reply[3] = outlet->dev_id >> 8;
+    reply[4] = outlet->dev_id;
+    reply[5] = outlet->state;
+    reply[6] = outlet->p_now >> 8;
+    reply[7] = outlet->p_now;
+    reply[8] = outlet->p_ttl >> 8;
+    reply[9] = outlet->p_ttl;
+
+    host_frame_schedule(at_us, reply, HOST_OUTLET_RSSI);
+}
+
+
+/*****************************************************************************/
+/** Display Unit Model: Poll Next Outlet
+ *
+ * Like the handheld display unit the poll is sent twice in quick succession
+ * and answered by the outlet afterwards.
+ */
+static void host_display_poll(
+    uint64_t now_us                             /**< current time */
+)
+{
+    struct host_outlet *outlet;
+    uint8_t frame[12];
+    uint32_t airtime = rfm69_sim_airtime_us(0, sizeof(frame));
+    unsigned int cnt;
+
+    if (!host_outlets_cnt) {
+        return;
+    }
+
+    outlet = &host_outlets[host_display_outlet++ % host_outlets_cnt];
+
+    for (cnt = 0; cnt < 2; cnt++) {
+        frame[0] = outlet->channel;
+        frame[1] = 4;
+        frame[2] = outlet->dev_id >> 16;
+        frame[3] = outlet->dev_id >> 8;
+        frame[4] = outlet->dev_id;
+        frame[5] = 0;
+        frame[6] = frame[7] = frame[8] = frame[9] = 0xaa;
+        host_frame_schedule(now_us + cnt * (airtime + HOST_DISPLAY_REPEAT_GAP_US), frame, HOST_DISPLAY_RSSI);
+    }
+
+    host_outlet_reply(outlet, 4, now_us + 2 * (airtime + HOST_DISPLAY_REPEAT_GAP_US) + HOST_OUTLET_REPLY_DELAY_US);
+}
+
+
+/*****************************************************************************/
+/** Outlet Model: Change Channel
+ *
+ * As if paired to a display unit again, the next reply reports the new
+ * channel and the node has to store it.
+ */
+static void host_repair(
+    void
+)
+{
+    struct host_outlet *outlet;
+
+    if (!host_outlets_cnt) {
+        return;
+    }
+
+    outlet = &host_outlets[host_repair_outlet++ % host_outlets_cnt];
+    outlet->channel = (outlet->channel % 250) + 1;
+}
+
+
+/*****************************************************************************/
+/** Outlet Model: Send Pairing Request
+ *
+ * The last outlet drops its channel and asks to be paired again. Being known
+ * already, the node does not store its configuration. Other outlets keep
+ * talking while the node waits before answering, their frames must still be
+ * received.
+ */
+static void host_pair_request(
+    uint64_t now_us                             /**< current time */
+)
+{
+    struct host_outlet *outlet;
+    uint8_t frame[12];
+    uint32_t airtime = rfm69_sim_airtime_us(0, sizeof(frame));
+    unsigned int cnt;
+
+    if (host_outlets_cnt < 2) {
+        return;
+    }
+
+    outlet = &host_outlets[host_outlets_cnt - 1];
+    outlet->channel = 0;
+    host_pair_outlet = outlet;
+
+    frame[0] = 0;
+    frame[1] = 17;
+    frame[2] = outlet->dev_id >> 16;
+    frame[3] = outlet->dev_id >> 8;
+    frame[4] = outlet->dev_id;
+    frame[5] = 0;
+    frame[6] = frame[7] = frame[8] = frame[9] = 0xaa;
+    host_frame_schedule(now_us, frame, HOST_OUTLET_RSSI);
+    host_pair_end_us = now_us + airtime;
+
+    for (cnt = 1; cnt <= HOST_PAIR_WINDOW_FRAMES; cnt++) {
+        host_outlet_reply(&host_outlets[cnt % (host_outlets_cnt - 1)], 4,
+                          now_us + cnt * (airtime + HOST_DISPLAY_REPEAT_GAP_US));
+    }
+}
+
+
+/*****************************************************************************/
+/** Outlet Model: React On Transmitted Frames
+ */
+static void host_outlet_tx_hook(
+    uint8_t radio,                              /**< sending radio */
+    const uint8_t *data,                        /**< frame */
+    uint8_t len,                                /**< frame length */
+    uint64_t now_us                             /**< end of transmission */
+)
+{
+    struct host_outlet *outlet = NULL;
+    uint32_t dev_id;
+    unsigned int cnt;
+
+    /* other radios of the node hear the frame as well */
+    host_air_schedule(now_us, data, len, HOST_LOCAL_RSSI, radio);
+
+    if ((12 > len) || (crc16_pca301(data, 10) != ((data[10] << 8) | data[11]))) {
+        return;
+    }
+
+    dev_id = ((uint32_t) data[2] << 16) | ((uint32_t) data[3] << 8) | data[4];
+    for (cnt = 0; cnt < host_outlets_cnt; cnt++) {
+        if (host_outlets[cnt].dev_id == dev_id) {
+            outlet = &host_outlets[cnt];
+            break;
+        }
+    }
+
+    if (!outlet) {
+        return;
+    }
+
+    switch (data[1]) {
+        case 4:                                 /* poll */
+            if (!outlet->polls++) {
+                outlet->first_poll_us = now_us;
+            }
+            break;
+        case 5:                                 /* switch */
+            outlet->state = data[5];
+            outlet->p_now = (outlet->state) ? outlet->p_load : 0;
+            break;
+        case 17:                                /* pairing answer */
+            outlet->channel = data[0];
+            if ((outlet == host_pair_outlet) && !host_pair_answer_us) {
+                host_pair_answer_us = now_us;
+            }
+            return;
+        default:
+            return;
+    }
+
+    host_outlet_reply(outlet, data[1], now_us + HOST_OUTLET_REPLY_DELAY_US);
+}
+
+
+/*****************************************************************************/
+/** Outlet Model: Count Replies That Reached The Receiving Radio
+ */
+static void host_outlet_rx_hook(
+    uint8_t radio,                              /**< receiving radio */
+    const uint8_t *data,                        /**< frame */
+    uint8_t len,                                /**< frame length */
+    uint64_t now_us                             /**< end of reception */
+)
+{
+    uint32_t dev_id;
+    unsigned int cnt;
+
+    /* display unit polls carry 0xaa instead of measurements */
+    if ((radio != hal_host_radio(pca301_rfm69_rx->pin_spi_ss)) || (12 > len)
+        || ((0xaa == data[6]) && (0xaa == data[7]) && (0xaa == data[8]) && (0xaa == data[9]))) {
+        return;
+    }
+
+    dev_id = ((uint32_t) data[2] << 16) | ((uint32_t) data[3] << 8) | data[4];
+
+    /* frames the node heard while its pairing answer was pending */
+    if (host_pair_outlet && (host_pair_outlet->dev_id != dev_id) && !host_pair_answer_us) {
+        host_pair_window_rx++;
+    }
+
+    for (cnt = 0; cnt < host_outlets_cnt; cnt++) {
+        if (host_outlets[cnt].dev_id == dev_id) {
+            if (!host_outlets[cnt].answers++) {
+                host_outlets[cnt].first_answer_us = now_us;
+            }
+            return;
+        }
+    }
+}
+
+
+/*****************************************************************************/
+/** Decode Binary Output And Print It As Text
+ */
+static void host_bin_hook(
+    uint8_t c                                   /**< serial output byte */
+)
+{
+    static const char *names[] = { "requests", "replies", "timeouts", "tx_dropped",
+                                   "switch_ok", "switch_failed", "out_dropped", "out_coalesced" };
+    struct pca301_bin_rec rec;
+    unsigned int cnt;
+    uint16_t value;
+    uint32_t zz;
+    unsigned int shift;
+
+    if (!pca301_bin_feed(&host_bin, c, &rec)) {
+        return;
+    }
+
+    switch (rec.type) {
+        case PCA_BIN_TEXT:
+            fwrite(rec.data, 1, rec.len, stdout);
+            return;
+        case PCA_BIN_RX:
+            printf("%u rx %s", rec.ts, (rec.len && !rec.data[0]) ? "ok" : "bad");
+            for (cnt = 1; cnt < rec.len; cnt++) {
+                printf(" %u", rec.data[cnt]);
+            }
+            break;
+        case PCA_BIN_TX:
+            printf("%u tx", rec.ts);
+            for (cnt = 0; cnt < rec.len; cnt++) {
+                printf(" %u", rec.data[cnt]);
+            }
+            break;
+        case PCA_BIN_DEV:
+            if (PCA_BIN_DEV_LEN != rec.len) {
+                return;
+            }
+            printf("%u dev %u retries %u channel %u id %06x state %u now %u total %u", rec.ts,
+                   rec.data[0], rec.data[1], rec.data[2],
+                   (rec.data[3] << 16) | (rec.data[4] << 8) | rec.data[5], rec.data[6],
+                   (rec.data[7] << 8) | rec.data[8], (rec.data[9] << 8) | rec.data[10]);
+            break;
+        case PCA_BIN_STATS:
+            printf("%u stats", rec.ts);
+            for (cnt = 0; (cnt + 1) * 4 <= rec.len && cnt < sizeof(names) / sizeof(names[0]); cnt++) {
+                printf(" %s %u", names[cnt], ((uint32_t) rec.data[cnt * 4] << 24) | ((uint32_t) rec.data[cnt * 4 + 1] << 16)
+                                             | ((uint32_t) rec.data[cnt * 4 + 2] << 8) | rec.data[cnt * 4 + 3]);
+            }
+            break;
+        case PCA_BIN_HIST:
+            if (PCA_BIN_HIST_LEN > rec.len) {
+                return;
+            }
+            printf("%u hist dev %u cnt %u min %u mean %u max %u samples", rec.ts, rec.data[0],
+                   (rec.data[1] << 8) | rec.data[2], (rec.data[3] << 8) | rec.data[4],
+                   (rec.data[5] << 8) | rec.data[6], (rec.data[7] << 8) | rec.data[8]);
+            if (PCA_BIN_HIST_LEN + 2 <= rec.len) {
+                value = (rec.data[9] << 8) | rec.data[10];
+                printf(" %u", value);
+                for (cnt = PCA_BIN_HIST_LEN + 2; cnt < rec.len; ) {
+                    for (zz = 0, shift = 0; cnt < rec.len; shift += 7) {
+                        zz |= (uint32_t) (rec.data[cnt] & 0x7f) << shift;
+                        if (!(rec.data[cnt++] & 0x80)) {
+                            break;
+                        }
+                    }
+                    value += (zz & 1) ? ~(zz >> 1) : zz >> 1;
+                    printf(" %u", value);
+                }
+            }
+            break;
+        case PCA_BIN_SAF:
+            if (PCA_BIN_SAF_LEN != rec.len) {
+                return;
+            }
+            printf("%u saf seq %u age %u", rec.ts, (rec.data[0] << 8) | rec.data[1], (rec.data[2] << 8) | rec.data[3]);
+            for (cnt = 4; cnt < rec.len; cnt++) {
+                printf(" %u", rec.data[cnt]);
+            }
+            break;
+        case PCA_BIN_LOST:
+            if (PCA_BIN_LOST_LEN != rec.len) {
+                return;
+            }
+            printf("%u lost seq %u count %u", rec.ts, (rec.data[0] << 8) | rec.data[1], (rec.data[2] << 8) | rec.data[3]);
+            break;
+        default:
+            printf("%u type %u len %u", rec.ts, rec.type, rec.len);
+            break;
+    }
+    printf("\n");
+}
+
+
+/*****************************************************************************/
+/** Host Side Output
+ */
+static void host_stdout(
+    uint8_t c                                   /**< serial output byte */
+)
+{
+    if (!host_quiet) {
+        fputc(c, stdout);
+    }
+}
+
+
+/*****************************************************************************/
+/** Serial Link Model: Host That Loses The Link For A While
+ *
+ * Output during the outage is lost. Received lines are checked for
+ * store-and-forward sequence numbers, after the outage the host asks for a
+ * replay after the last one it saw.
+ */
+static void host_link_hook(
+    uint8_t c                                   /**< serial output byte */
+)
+{
+    uint64_t now_us = hal_host_time_ns() / 1000;
+    unsigned long seq;
+    unsigned long cnt;
+
+    if ((now_us >= host_link_down_us) && (now_us < host_link_up_us)) {
+        host_link_len = ('\n' == c) ? 0 : sizeof(host_link_line);
+        return;
+    }
+
+    host_link_next(c);
+
+    if ('\n' != c) {
+        if (host_link_len < sizeof(host_link_line) - 1) {
+            host_link_line[host_link_len++] = c;
+        }
+        return;
+    }
+    if (host_link_len >= sizeof(host_link_line)) {
+        host_link_len = 0;                      /* rest of a line cut by the outage */
+        return;
+    }
+    host_link_line[host_link_len] = 0;
+    host_link_len = 0;
+
+    if (2 == sscanf(host_link_line, "#LOST %lu %lu", &seq, &cnt)) {
+        host_link_lost += cnt;
+        if ((long) (seq + cnt - 1) > host_link_seq) {
+            host_link_seq = seq + cnt - 1;
+        }
+    } else if (1 == sscanf(host_link_line, "F %lu", &seq)) {
+        if ((long) seq <= host_link_seq) {
+            host_link_dups++;
+            return;
+        }
+        if (host_link_seq >= 0) {
+            host_link_missing += seq - host_link_seq - 1;
+        }
+        host_link_seq = seq;
+        host_link_readings++;
+    } else if (!strncmp(host_link_line, "OK ", 3)) {
+        host_link_ok++;
+    }
+}
+
+
+/*****************************************************************************/
+/** Read Scripted Serial Input From Stream
+ */
+static void host_input_read(
+    FILE *in                                    /**< input stream */
+)
+{
+    char line[256];
+    uint64_t at_ns = 0;
+
+    while (fgets(line, sizeof(line), in)) {
+        if ('@' == line[0]) {
+            at_ns = strtoull(line + 1, NULL, 10) * 1000000ULL;
+            continue;
+        }
+        hal_host_serial_input(at_ns, line, strlen(line));
+    }
+}
+
+
+/*****************************************************************************/
+/** Generate Random Command Lines Following The Input Grammar
+ *
+ * Lines are built from comma separated value lists ending in a command
+ * letter, 0x<hhhh> h frequency arguments, +/-/# and a few arbitrary bytes.
+ * The generator has its own seed so the simulation itself is not affected.
+ */
+static void host_fuzz_input(
+    unsigned int lines                          /**< number of lines */
+)
+{
+    static const char cmds[] = "acdeklpqrsvh";
+    static const char hex[] = "0123456789ABCDEFabcdefg";
+    uint32_t seed = 1;
+    char line[128];
+    unsigned int len;
+    unsigned int cnt;
+
+#define HOST_FUZZ_RAND(range) ((seed = seed * 1103515245 + 12345), (seed >> 16) % (range))
+
+    for (; lines; lines--) {
+        len = 0;
+        while (len < sizeof(line) - 64) {
+            switch (HOST_FUZZ_RAND(8)) {
+                case 0:                         /* frequency argument */
+                    line[len++] = 'x';
+                    for (cnt = HOST_FUZZ_RAND(7); cnt; cnt--) {
+                        line[len++] = hex[HOST_FUZZ_RAND(sizeof(hex) - 1)];
+                    }
+                    line[len++] = 'h';
+                    break;
+                case 1:                         /* frequency step and test */
+                    line[len++] = "+-#"[HOST_FUZZ_RAND(3)];
+                    break;
+                case 2:                         /* arbitrary byte */
+                    line[len++] = HOST_FUZZ_RAND(256);
+                    break;
+                default:                        /* value list and command */
+                    for (cnt = HOST_FUZZ_RAND(14); cnt; cnt--) {
+                        len += snprintf(line + len, 5, "%u,", (unsigned int) HOST_FUZZ_RAND(300));
+                    }
+                    len += snprintf(line + len, 4, "%u", (unsigned int) HOST_FUZZ_RAND(300));
+                    line[len++] = (HOST_FUZZ_RAND(4)) ? cmds[HOST_FUZZ_RAND(sizeof(cmds) - 1)] : 'a' + HOST_FUZZ_RAND(23);
+                    break;
+            }
+            if (!HOST_FUZZ_RAND(3)) {
+                break;
+            }
+            if (!HOST_FUZZ_RAND(2)) {
+                line[len++] = ' ';
+            }
+        }
+        line[len++] = '\n';
+        hal_host_serial_input(0, line, len);
+    }
+
+#undef HOST_FUZZ_RAND
+}
+
+
+/*****************************************************************************/
+/** Print Statistics
+ */
+static void host_stats_print(
+    uint64_t loops,                             /**< loop iterations */
+    uint64_t loop_max_ns                        /**< longest loop iteration */
+)
+{
+    const struct rfm69_sim_stats *tx = rfm69_sim_stats_get(hal_host_radio(pca301_rfm69_tx->pin_spi_ss));
+    const struct rfm69_sim_stats *rx = rfm69_sim_stats_get(hal_host_radio(pca301_rfm69_rx->pin_spi_ss));
+    const struct hal_host_stats *hal = hal_host_stats_get();
+    struct rfm69_sim_stats sum;
+    const struct rfm69_sim_stats *sim;
+    unsigned int cnt;
+    uint8_t radio;
+    unsigned int polled = 0;
+    uint64_t sweep_us = 0;
+    uint32_t polls_max = 0;
+    unsigned int answered = 0;
+    uint64_t answer_us = 0;
+    const struct struct_pcaStats *pca = pca301serial_stats();
+
+    /* time until every outlet was polled and answered once, polls of the most polled one */
+    for (cnt = 0; cnt < host_outlets_cnt; cnt++) {
+        if (host_outlets[cnt].polls) {
+            polled++;
+            if (host_outlets[cnt].first_poll_us > sweep_us) {
+                sweep_us = host_outlets[cnt].first_poll_us;
+            }
+            if (host_outlets[cnt].polls > polls_max) {
+                polls_max = host_outlets[cnt].polls;
+            }
+        }
+        if (host_outlets[cnt].answers) {
+            answered++;
+            if (host_outlets[cnt].first_answer_us > answer_us) {
+                answer_us = host_outlets[cnt].first_answer_us;
+            }
+        }
+    }
+
+    /* bus and register counters of all radios */
+    memset(&sum, 0, sizeof(sum));
+    for (radio = 0; radio < RFM69_SIM_RADIOS; radio++) {
+        sim = rfm69_sim_stats_get(radio);
+        sum.spi_transactions += sim->spi_transactions;
+        sum.spi_bytes += sim->spi_bytes;
+        sum.mode_changes += sim->mode_changes;
+        for (cnt = 0; cnt < 128; cnt++) {
+            sum.reg_reads[cnt] += sim->reg_reads[cnt];
+            sum.reg_writes[cnt] += sim->reg_writes[cnt];
+        }
+    }
+
+    fprintf(stderr, "time_ms %llu\n", (unsigned long long) (hal_host_time_ns() / 1000000));
+    fprintf(stderr, "setup_us %.1f\n", host_setup_ns / 1000.0);
+    fprintf(stderr, "setup_spi_transactions %u\n", host_setup_spi);
+    fprintf(stderr, "boot_ms %u\n", pca->bootMs);
+    fprintf(stderr, "first_rx_ms %d\n", (pca->firstRxMs) ? (int) pca->firstRxMs : -1);
+    fprintf(stderr, "loops %llu\n", (unsigned long long) loops);
+    fprintf(stderr, "loop_avg_us %.2f\n", (loops) ? hal_host_time_ns() / 1000.0 / loops : 0.0);
+    fprintf(stderr, "loop_max_us %.2f\n", loop_max_ns / 1000.0);
+    fprintf(stderr, "spi_transactions %u\n", sum.spi_transactions);
+    fprintf(stderr, "spi_bytes %u\n", sum.spi_bytes);
+    fprintf(stderr, "drv_spi_transactions %u\n", rfm69_spi_stats_get(pca301_rfm69_tx)->transactions);
+    fprintf(stderr, "drv_spi_tx_transactions %u\n", rfm69_spi_stats_get(pca301_rfm69_tx)->tx_transactions);
+    fprintf(stderr, "drv_spi_skipped %u\n", rfm69_spi_stats_get(pca301_rfm69_tx)->skipped);
+    fprintf(stderr, "mode_changes %u\n", sum.mode_changes);
+    fprintf(stderr, "tx_frames %u\n", tx->tx_frames);
+    fprintf(stderr, "tx_cycles %u\n", tx->tx_cycles);
+    fprintf(stderr, "tx_cycle_avg_us %.1f\n", (tx->tx_cycles) ? (double) tx->tx_cycle_us / tx->tx_cycles : 0.0);
+    fprintf(stderr, "tx_cycle_max_us %u\n", tx->tx_cycle_max_us);
+    fprintf(stderr, "tx_rearm_avg_us %.1f\n", (tx->tx_cycles) ? (double) tx->tx_rearm_us / tx->tx_cycles : 0.0);
+    fprintf(stderr, "rx_frames %u\n", rx->rx_frames);
+    fprintf(stderr, "rx_lost %u\n", rx->rx_lost);
+    fprintf(stderr, "rx_queued %u\n", rfm69_rx_stats_get(pca301_rfm69_rx)->frames);
+    fprintf(stderr, "rx_queue_overflow %u\n", rfm69_rx_stats_get(pca301_rfm69_rx)->overflow);
+    fprintf(stderr, "irqs %u\n", hal->irqs);
+    fprintf(stderr, "polled_outlets %u\n", polled);
+    fprintf(stderr, "poll_sweep_ms %.1f\n", (polled == host_outlets_cnt) ? sweep_us / 1000.0 : -1.0);
+    fprintf(stderr, "polls_max %u\n", polls_max);
+    fprintf(stderr, "answered_outlets %u\n", answered);
+    fprintf(stderr, "answer_sweep_ms %.1f\n", (answered == host_outlets_cnt) ? answer_us / 1000.0 : -1.0);
+    fprintf(stderr, "req_sent %u\n", pca->requests);
+    fprintf(stderr, "req_replies %u\n", pca->replies);
+    fprintf(stderr, "req_timeouts %u\n", pca->timeouts);
+    fprintf(stderr, "req_rtt_avg_ms %.1f\n", (pca->replies) ? (double) pca->rttSum / pca->replies : 0.0);
+    fprintf(stderr, "req_rtt_max_ms %u\n", pca->rttMax);
+    for (cnt = 0; cnt < PCA_TX_CLASSES; cnt++) {
+        fprintf(stderr, "txq_%s_frames %u\n", host_txq_class[cnt], pca->txFrames[cnt]);
+        fprintf(stderr, "txq_%s_delay_avg_ms %.1f\n", host_txq_class[cnt],
+                (pca->txFrames[cnt]) ? (double) pca->txDelaySum[cnt] / pca->txFrames[cnt] : 0.0);
+        fprintf(stderr, "txq_%s_delay_max_ms %u\n", host_txq_class[cnt], pca->txDelayMax[cnt]);
+    }
+    fprintf(stderr, "txq_merged %u\n", pca->txMerged);
+    fprintf(stderr, "txq_dropped %u\n", pca->txDropped);
+    fprintf(stderr, "txq_failed %u\n", pca->txFailed);
+    if (host_pair_us) {
+        fprintf(stderr, "pair_answer_ms %.1f\n", (host_pair_answer_us) ? (host_pair_answer_us - host_pair_end_us) / 1000.0 : -1.0);
+        fprintf(stderr, "pair_window_rx %u/%u\n", host_pair_window_rx, HOST_PAIR_WINDOW_FRAMES);
+    }
+    fprintf(stderr, "switch_ok %u\n", pca->swOk);
+    fprintf(stderr, "switch_failed %u\n", pca->swFailed);
+    fprintf(stderr, "switch_tries_avg %.2f\n", (pca->swOk + pca->swFailed) ? (double) pca->swTries / (pca->swOk + pca->swFailed) : 0.0);
+    fprintf(stderr, "switch_time_avg_ms %.1f\n", (pca->swOk) ? (double) pca->swTimeSum / pca->swOk : 0.0);
+    fprintf(stderr, "switch_time_max_ms %u\n", pca->swTimeMax);
+    fprintf(stderr, "group_ok %u\n", pca->grpOk);
+    fprintf(stderr, "group_failed %u\n", pca->grpFailed);
+    fprintf(stderr, "group_time_max_ms %u\n", pca->grpTimeMax);
+    fprintf(stderr, "out_lines %u\n", pca->outLines);
+    fprintf(stderr, "out_lines_per_s %.1f\n", pca->outLines * 1000000000.0 / hal_host_time_ns());
+    fprintf(stderr, "out_dropped %u\n", pca->outDropped);
+    fprintf(stderr, "out_coalesced %u\n", pca->outCoalesced);
+    fprintf(stderr, "out_ring_max %u\n", pca->outMax);
+    fprintf(stderr, "rep_sent %u\n", pca->repSent);
+    fprintf(stderr, "rep_suppressed %u\n", pca->repSuppressed);
+    fprintf(stderr, "rep_coalesced %u\n", pca->repCoalesced);
+    fprintf(stderr, "rep_beats %u\n", pca->repBeats);
+    fprintf(stderr, "saf_stored %u\n", pca->safStored);
+    fprintf(stderr, "saf_sent %u\n", pca->safSent);
+    fprintf(stderr, "saf_dropped %u\n", pca->safDropped);
+    fprintf(stderr, "saf_lost %u\n", pca->safLost);
+    fprintf(stderr, "dev_lookups %u\n", pca->devLookups);
+    fprintf(stderr, "dev_compares_avg %.2f\n", (pca->devLookups) ? (double) pca->devCompares / pca->devLookups : 0.0);
+    if (host_link_up_us) {
+        fprintf(stderr, "link_ok_lines %u\n", host_link_ok);
+        fprintf(stderr, "link_readings %u\n", host_link_readings);
+        fprintf(stderr, "link_dups %u\n", host_link_dups);
+        fprintf(stderr, "link_lost %u\n", host_link_lost);
+        fprintf(stderr, "link_missing %u\n", host_link_missing);
+    }
+    fprintf(stderr, "serial_tx_bytes %u\n", hal->serial_tx_bytes);
+    fprintf(stderr, "bin_records %u\n", host_bin.records);
+    fprintf(stderr, "bin_errors %u\n", host_bin.errors);
+    fprintf(stderr, "serial_tx_block_us %llu\n", (unsigned long long) (hal->serial_tx_block_ns / 1000));
+    fprintf(stderr, "serial_rx_bytes %u\n", hal->serial_rx_bytes);
+    fprintf(stderr, "serial_rx_overflow %u\n", hal->serial_rx_overflow);
+    fprintf(stderr, "serial_rx_wait_avg_us %.1f\n", (hal->serial_rx_bytes) ? hal->serial_rx_wait_ns / 1000.0 / hal->serial_rx_bytes : 0.0);
+    fprintf(stderr, "serial_rx_wait_max_us %llu\n", (unsigned long long) (hal->serial_rx_wait_max_ns / 1000));
+    fprintf(stderr, "cmds %u\n", pca->cmds);
+    fprintf(stderr, "input_done_ms %.1f\n", host_input_done_ns / 1000000.0);
+    fprintf(stderr, "cmds_per_s %.0f\n", (host_input_done_ns) ? pca->cmds * 1000000000.0 / host_input_done_ns : 0.0);
+    fprintf(stderr, "eeprom_writes %u\n", hal->eeprom_writes);
+    fprintf(stderr, "eeprom_cell_max %u\n", hal->eeprom_cell_max);
+    fprintf(stderr, "eeprom_block_us %llu\n", (unsigned long long) (hal->eeprom_block_ns / 1000));
+
+    for (radio = 0; radio < RFM69_SIM_RADIOS; radio++) {
+        if (rfm69_sim_present(radio)) {
+            sim = rfm69_sim_stats_get(radio);
+            fprintf(stderr, "radio %u spi %u tx %u rx %u lost %u\n", radio,
+                    sim->spi_transactions, sim->tx_frames, sim->rx_frames, sim->rx_lost);
+        }
+    }
+
+    for (cnt = 0; cnt < 128; cnt++) {
+        if (sum.reg_reads[cnt] || sum.reg_writes[cnt]) {
+            fprintf(stderr, "reg 0x%02x r %u w %u\n", cnt, sum.reg_reads[cnt], sum.reg_writes[cnt]);
+        }
+    }
+}
+
+
+/*****************************************************************************/
+/** Device Lookup: Linear Scan As Done Before The Index
+ *
+ * @returns devId compares of the scan
+ */
+static unsigned int host_lookup_scan(
+    uint32_t dev_id                             /**< device id */
+)
+{
+    const struct struct_pcaDev *dev;
+    unsigned int cnt;
+
+    for (cnt = 0; cnt < pcaConf.numDev; cnt++) {
+        dev = &pcaConf.pcaDev[cnt];
+        if ((((uint32_t) dev->devId[0] << 16) | ((uint32_t) dev->devId[1] << 8) | dev->devId[2]) == dev_id) {
+            return cnt + 1;
+        }
+    }
+
+    return pcaConf.numDev;
+}
+
+
+/*****************************************************************************/
+/** Device Lookup: Let The Node Receive One Frame Of A Device
+ *
+ * Frames lost to a transmission of the node are sent again.
+ *
+ * @returns devId compares of the index lookup
+ */
+static unsigned int host_lookup_frame(
+    uint32_t dev_id                             /**< device id */
+)
+{
+    const struct struct_pcaStats *pca = pca301serial_stats();
+    uint32_t lookups = pca->devLookups;
+    uint32_t compares = pca->devCompares;
+    uint64_t timeout_us = 0;
+    uint8_t frame[12];
+
+    while (lookups == pca->devLookups) {
+        if (hal_host_time_ns() / 1000 >= timeout_us) {
+            memset(frame, 0, sizeof(frame));
+            frame[0] = 1;
+            frame[1] = 4;
+            frame[2] = dev_id >> 16;
+            frame[3] = dev_id >> 8;
+            frame[4] = dev_id;
+            host_frame_schedule(hal_host_time_ns() / 1000, frame, HOST_OUTLET_RSSI);
+            timeout_us = hal_host_time_ns() / 1000 + HOST_LOOKUP_TIMEOUT_US;
+        }
+        loop();
+    }
+
+    return pca->devCompares - compares;
+}
+
+
+/*****************************************************************************/
+/** Device Lookup: Unused Random Device Id
+ */
+static uint32_t host_lookup_new_id(
+    unsigned int learned                        /**< ids in use */
+)
+{
+    uint32_t dev_id;
+    unsigned int cnt;
+
+    do {
+        dev_id = (((uint32_t) rand() << 8) ^ rand()) & 0xffffff;
+        for (cnt = 0; (cnt < learned) && (host_lookup_ids[cnt] != dev_id); cnt++) {
+        }
+    } while (!dev_id || (cnt < learned));
+
+    return dev_id;
+}
+
+
+/*****************************************************************************/
+/** Device Lookup Scenario
+ *
+ * Clears the configuration and lets the node learn PCA_MAXDEV devices with
+ * random ids, one at a time. After each new device the node receives frames
+ * of randomly chosen known devices. Every received frame is one lookup, the
+ * frame of a new device is a miss. The devId compares of the index are taken
+ * from the node statistics, the compares of the linear scan used before are
+ * counted on the same configuration. With a full table the node ignores new
+ * devices, so the last line repeats the misses without learning them.
+ */
+static void host_lookup_run(
+    unsigned int lookups                        /**< hits per learned device */
+)
+{
+    const struct struct_pcaStats *pca = pca301serial_stats();
+    unsigned long idx_hit = 0, idx_miss = 0, scan_hit = 0, scan_miss = 0;
+    unsigned int hits = 0, misses = 0;
+    unsigned int row = 1;
+    unsigned int learned;
+    unsigned int cnt;
+    uint32_t dev_id;
+    uint32_t cmds;
+
+    /* the outlets stay silent, only frames sent here are looked up */
+    host_outlets_cnt = 0;
+    hal_host_serial_output(NULL);
+
+    cmds = pca->cmds;
+    hal_host_serial_input(hal_host_time_ns(), "0c\n", 3);
+    while (cmds == pca->cmds) {
+        loop();
+    }
+
+    printf("lookup devices %u hits per device %u\n", PCA_MAXDEV, lookups);
+    printf("%7s %9s %9s %9s %9s\n", "devices", "idx_hit", "idx_miss", "scan_hit", "scan_miss");
+
+    for (learned = 0; learned < PCA_MAXDEV; ) {
+        dev_id = host_lookup_new_id(learned);
+        scan_miss += host_lookup_scan(dev_id);
+        idx_miss += host_lookup_frame(dev_id);
+        misses++;
+        host_lookup_ids[learned++] = dev_id;
+
+        for (cnt = 0; cnt < lookups; cnt++) {
+            dev_id = host_lookup_ids[rand() % learned];
+            scan_hit += host_lookup_scan(dev_id);
+            idx_hit += host_lookup_frame(dev_id);
+            hits++;
+        }
+
+        /* one line per doubling, averaged over the devices since the last */
+        if ((learned == row) || (learned == PCA_MAXDEV)) {
+            printf("%7u %9.2f %9.2f %9.2f %9.2f\n", learned,
+                   (hits) ? (double) idx_hit / hits : 0.0, (double) idx_miss / misses,
+                   (hits) ? (double) scan_hit / hits : 0.0, (double) scan_miss / misses);
+            idx_hit = idx_miss = scan_hit = scan_miss = 0;
+            hits = misses = 0;
+            row *= 2;
+        }
+    }
+
+    for (cnt = 0; cnt < lookups; cnt++) {
+        dev_id = host_lookup_new_id(learned);
+        scan_miss += host_lookup_scan(dev_id);
+        idx_miss += host_lookup_frame(dev_id);
+        misses++;
+    }
+    printf("%7s %9s %9.2f %9s %9.2f\n", "full", "-", (double) idx_miss / misses, "-", (double) scan_miss / misses);
+}
+
+
+/*****************************************************************************/
+/** Usage
+ */
+static void host_usage(
+    const char *name                            /**< program name */
+)
+{
+    fprintf(stderr,
+            "usage: %s [-t seconds] [-n outlets] [-d ms] [-p ms] [-c ms] [-z lines] [-w percent] [-l ms:ms] [-e eeprom.bin] [-b] [-q] [-s] [-r frames] [-k lookups]\n"
+            "  -t  virtual run time in seconds (default 10)\n"
+            "  -n  number of simulated outlets (default 2)\n"
+            "  -d  period of a simulated display unit polling the outlets\n"
+            "  -p  time of a pairing request from a new outlet, other outlets\n"
+            "      send frames while the answer is pending\n"
+            "  -c  period of outlets changing their channel one after another\n"
+            "  -z  random command lines following the input grammar, sent\n"
+            "      after the scripted input\n"
+            "  -w  outlets start switched on, their power fluctuates by up\n"
+            "      to this percentage from reply to reply\n"
+            "  -l  serial link down between these times, output is lost and\n"
+            "      the host asks for a replay of F lines afterwards (1f)\n"
+            "  -e  EEPROM image, loaded at start and stored at exit\n"
+            "  -b  decode binary output (command 1b) and print it as text\n"
+            "  -q  suppress serial output\n"
+            "  -s  print statistics to stderr\n"
+            "  -r  time the CRC16 implementations over this many frames\n"
+            "      and exit, the simulation does not run\n"
+            "  -k  learn devices up to PCA_MAXDEV, do this many lookups per\n"
+            "      device and print the devId compares per lookup against a\n"
+            "      linear scan, replaces the normal simulation\n",
+            name);
+}
+
+
+/*****************************************************************************/
+/** Main
+ */
+int main(
+    int argc,
+    char **argv
+)
+{
+    uint64_t end_ns = 10ULL * 1000000000ULL;
+    const char *eeprom = NULL;
+    unsigned int fuzz = 0;
+    unsigned int crc_frames = 0;
+    unsigned int lookups = 0;
+    bool stats = false;
+    uint64_t loops = 0;
+    uint64_t loop_max_ns = 0;
+    uint64_t ts;
+    unsigned int cnt;
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "t:n:d:p:c:z:w:l:e:bqsr:k:h"))) {
+        switch (opt) {
+            case 't':
+                end_ns = (uint64_t) (atof(optarg) * 1000000000.0);
+                break;
+            case 'n':
+                host_outlets_cnt = atoi(optarg);
+                if (host_outlets_cnt > HOST_OUTLETS_MAX) {
+                    host_outlets_cnt = HOST_OUTLETS_MAX;
+                }
+                break;
+            case 'd':
+                host_display_period_us = (uint64_t) atoi(optarg) * 1000;
+                host_display_next_us = host_display_period_us;
+                break;
+            case 'c':
+                host_repair_period_us = (uint64_t) atoi(optarg) * 1000;
+                host_repair_next_us = host_repair_period_us;
+                break;
+            case 'p':
+                host_pair_us = (uint64_t) atoi(optarg) * 1000;
+                break;
+            case 'z':
+                fuzz = atoi(optarg);
+                break;
+            case 'w':
+                host_load_noise = atoi(optarg);
+                break;
+            case 'l':
+                host_link_down_us = (uint64_t) atoi(optarg) * 1000;
+                host_link_up_us = (strchr(optarg, ':')) ? (uint64_t) atoi(strchr(optarg, ':') + 1) * 1000 : 0;
+                break;
+            case 'e':
+                eeprom = optarg;
+                break;
+            case 'b':
+                pca301_bin_init(&host_bin);
+                hal_host_serial_output_hook(host_bin_hook);
+                host_link_next = host_bin_hook;
+                break;
+            case 'q':
+                hal_host_serial_output(NULL);
+                host_quiet = true;
+                break;
+            case 's':
+                stats = true;
+                break;
+            case 'r':
+                crc_frames = atoi(optarg);
+                break;
+            case 'k':
+                lookups = atoi(optarg);
+                break;
+            default:
+                host_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (crc_frames) {
+        return (crc16_bench_run(crc_frames)) ? 0 : 1;
+    }
+
+    /* the link model passes what gets through to the decoder or stdout */
+    if (host_link_up_us) {
+        if (!host_link_next) {
+            host_link_next = host_stdout;
+        }
+        hal_host_serial_output_hook(host_link_hook);
+    }
+
+    /* the first two outlets match the default configuration */
+    for (cnt = 0; cnt < host_outlets_cnt; cnt++) {
+        host_outlets[cnt].dev_id = (cnt < 2) ? 0xaaaaa + cnt * 0x11111 : 0x100000 + cnt;
+        host_outlets[cnt].channel = cnt + 1;
+        host_outlets[cnt].p_ttl = cnt * 10;
+        host_outlets[cnt].p_load = 400 + (host_outlets[cnt].dev_id & 0xff);
+        if (host_load_noise) {
+            host_outlets[cnt].state = 1;
+            host_outlets[cnt].p_now = host_outlets[cnt].p_load;
+        }
+    }
+
+    if (eeprom) {
+        hal_host_eeprom_load(eeprom);
+    }
+
+    if (!isatty(STDIN_FILENO)) {
+        host_input_read(stdin);
+    }
+    host_fuzz_input(fuzz);
+
+    srand(1);
+    rfm69_sim_tx_hook(host_outlet_tx_hook);
+    rfm69_sim_rx_hook(host_outlet_rx_hook);
+
+    setup();
+    host_setup_ns = hal_host_time_ns();
+    for (cnt = 0; cnt < RFM69_SIM_RADIOS; cnt++) {
+        host_setup_spi += rfm69_sim_stats_get(cnt)->spi_transactions;
+    }
+
+    if (lookups) {
+        host_lookup_run(lookups);
+        end_ns = 0;
+    }
+
+    while (hal_host_time_ns() < end_ns) {
+        ts = hal_host_time_ns();
+
+        if (host_display_period_us && (ts / 1000 >= host_display_next_us)) {
+            host_display_poll(ts / 1000);
+            host_display_next_us += host_display_period_us;
+        }
+        if (host_repair_period_us && (ts / 1000 >= host_repair_next_us)) {
+            host_repair();
+            host_repair_next_us += host_repair_period_us;
+        }
+        if (host_pair_us && !host_pair_end_us && (ts / 1000 >= host_pair_us)) {
+            host_pair_request(ts / 1000);
+        }
+        if (host_link_up_us && !host_link_resumed && (ts / 1000 >= host_link_up_us)) {
+            char resume[32];
+            host_link_resumed = true;
+            if (host_link_seq >= 0) {
+                snprintf(resume, sizeof(resume), "\n%lu,%lu,1g\n", (host_link_seq >> 8) & 0xff, host_link_seq & 0xff);
+                hal_host_serial_input(ts, resume, strlen(resume));
+            }
+        }
+        loop();
+        loops++;
+
+        if (!host_input_done_ns && !hal_host_serial_input_pending()) {
+            host_input_done_ns = hal_host_time_ns();
+        }
+
+        ts = hal_host_time_ns() - ts;
+        if (ts > loop_max_ns) {
+            loop_max_ns = ts;
+        }
+    }
+
+    fflush(stdout);
+
+    if (eeprom) {
+        hal_host_eeprom_save(eeprom);
+    }
+
+    if (stats) {
+        host_stats_print(loops, loop_max_ns);
+    }
+
+    return 0;
+}
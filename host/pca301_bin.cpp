@@ -0,0 +1,113 @@
+/**
+ * @brief Decoder For The Binary Output Of pca301serial_rfm69
+ *
+ * Text printed before binary output was enabled ends up in the first frame
+ * and is counted as an error.
+ *
+ * Copyright (c) 2017, Sven Bachmann <dev@mcbachmann.de>
+ *
+ * Licensed under the MIT license, see LICENSE for details.
+ */
+#include <string.h>
+#include "crc16_pca301.h"
+#include "pca301_bin.h"
+
+
+/*****************************************************************************/
+/* Local defines */
+/*****************************************************************************/
+#define PCA301_BIN_HEADER                           5       /**< type and timestamp */
+#define PCA301_BIN_CRC                              2
+
+
+/*****************************************************************************/
+/** Reverse COBS In Place
+ *
+ * Returns the decoded length or -1 if a code byte points past the frame.
+ */
+static int pca301_bin_cobs(
+    uint8_t *buf,                               /**< encoded frame without delimiter */
+    unsigned int len                            /**< encoded length */
+)
+{
+    unsigned int pos = 0;
+    unsigned int out = 0;
+    uint8_t code;
+    uint8_t cnt;
+
+    while (pos < len) {
+        code = buf[pos++];
+        if (!code || (pos + code - 1 > len)) {
+            return -1;
+        }
+        for (cnt = 1; cnt < code; cnt++) {
+            buf[out++] = buf[pos++];
+        }
+        if ((code < 0xff) && (pos < len)) {
+            buf[out++] = 0;
+        }
+    }
+
+    return out;
+}
+
+
+/*****************************************************************************/
+/** Initialize Decoder
+ */
+void pca301_bin_init(
+    struct pca301_bin *dec                      /**< decoder */
+)
+{
+    memset(dec, 0, sizeof(*dec));
+}
+
+
+/*****************************************************************************/
+/** Feed One Byte
+ *
+ * Returns true if the byte completed a valid record.
+ */
+bool pca301_bin_feed(
+    struct pca301_bin *dec,                     /**< decoder */
+    uint8_t c,                                  /**< received byte */
+    struct pca301_bin_rec *rec                  /**< record, valid until the next call */
+)
+{
+    int len;
+    uint16_t crc;
+
+    if (c) {
+        if (dec->len < sizeof(dec->buf)) {
+            dec->buf[dec->len++] = c;
+        } else {
+            dec->overflow = true;
+        }
+        return false;
+    }
+
+    len = (dec->overflow) ? -1 : pca301_bin_cobs(dec->buf, dec->len);
+    dec->len = 0;
+    dec->overflow = false;
+
+    if (len < PCA301_BIN_HEADER + PCA301_BIN_CRC) {
+        dec->errors++;
+        return false;
+    }
+
+    len -= PCA301_BIN_CRC;
+    crc = crc16_pca301(dec->buf, len);
+    if (crc != ((dec->buf[len] << 8) | dec->buf[len + 1])) {
+        dec->errors++;
+        return false;
+    }
+
+    rec->type = dec->buf[0];
+    rec->ts = ((uint32_t) dec->buf[1] << 24) | ((uint32_t) dec->buf[2] << 16)
+              | ((uint32_t) dec->buf[3] << 8) | dec->buf[4];
+    rec->data = dec->buf + PCA301_BIN_HEADER;
+    rec->len = len - PCA301_BIN_HEADER;
+    dec->records++;
+
+    return true;
+}
@@ -0,0 +1,58 @@
+/**
+ * @brief Decoder For The Binary Output Of pca301serial_rfm69
+ *
+ * Takes the serial output byte by byte, splits it at the 0 delimiters,
+ * reverses the COBS encoding and checks the CRC. The record layout and types
+ * are defined by PCA_BIN_* in pca301_rfm69.h.
+ *
+ * Copyright (c) 2017, Sven Bachmann <dev@mcbachmann.de>
+ *
+ * Licensed under the MIT license, see LICENSE for details.
+ */
+#ifndef PCA301_BIN_H
+#define PCA301_BIN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*****************************************************************************/
+/* Defines */
+/*****************************************************************************/
+#define PCA301_BIN_BUF_SIZE                         256
+
+
+/*****************************************************************************/
+/* Structures */
+/*****************************************************************************/
+struct pca301_bin {
+    uint8_t buf[PCA301_BIN_BUF_SIZE];           /**< encoded bytes since the last delimiter */
+    unsigned int len;                           /**< bytes in buf */
+    bool overflow;                              /**< frame longer than buf */
+    uint32_t records;                           /**< valid records */
+    uint32_t errors;                            /**< frames with bad encoding or CRC */
+};
+
+struct pca301_bin_rec {
+    uint8_t type;                               /**< record type */
+    uint32_t ts;                                /**< node time in ms */
+    const uint8_t *data;                        /**< payload */
+    uint8_t len;                                /**< payload length */
+};
+
+
+/*****************************************************************************/
+/* Prototypes */
+/*****************************************************************************/
+void pca301_bin_init(
+    struct pca301_bin *dec                      /**< decoder */
+);
+
+bool pca301_bin_feed(
+    struct pca301_bin *dec,                     /**< decoder */
+    uint8_t c,                                  /**< received byte */
+    struct pca301_bin_rec *rec                  /**< record, valid until the next call */
+);
+
+
+#endif /* PCA301_BIN_H */
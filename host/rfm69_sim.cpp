@@ -0,0 +1,768 @@
+/**
+ * @brief RFM69 Register-Level Simulator
+ *
+ * Several transceivers share one clock, each one keeps its own register file
+ * and FIFO.
+ *
+ * Timing values are rough approximations of the datasheet figures. They are
+ * good enough to make the ModeReady and PacketSent wait loops of the driver
+ * behave like on real hardware.
+ *
+ * Copyright (c) 2017, Sven Bachmann <dev@mcbachmann.de>
+ *
+ * Licensed under the MIT license, see LICENSE for details.
+ */
+#include <string.h>
+#include "hal_host_compat.h"
+#include "funky_rfm69.h"
+#include "rfm69_sim.h"
+
+
+/*****************************************************************************/
+/* Local defines */
+/*****************************************************************************/
+#define SIM_MODE_READY_STANDBY_US                   20
+#define SIM_MODE_READY_TX_US                        120
+#define SIM_MODE_READY_RX_US                        120
+
+#define SIM_REG_PREAMBLEMSB                         0x2c
+#define SIM_REG_PREAMBLELSB                         0x2d
+#define SIM_REG_RSSIVALUE                           0x24
+#define SIM_REG_AUTOMODES                           0x3b
+
+#define SIM_AUTOMODES_ENTER_FIFONOTEMPTY            1
+#define SIM_AUTOMODES_EXIT_PACKETSENT               6
+
+#define SIM_IRQFLAGS1_MODEREADY                     (1 << 7)
+#define SIM_IRQFLAGS1_RXREADY                       (1 << 6)
+#define SIM_IRQFLAGS1_TXREADY                       (1 << 5)
+#define SIM_IRQFLAGS1_AUTOMODE                      (1 << 1)
+
+#define SIM_IRQFLAGS2_FIFOFULL                      (1 << 7)
+#define SIM_IRQFLAGS2_FIFONOTEMPTY                  (1 << 6)
+#define SIM_IRQFLAGS2_FIFOOVERRUN                   (1 << 4)
+#define SIM_IRQFLAGS2_PACKETSENT                    (1 << 3)
+#define SIM_IRQFLAGS2_PAYLOADREADY                  (1 << 2)
+#define SIM_IRQFLAGS2_CRCOK                         (1 << 1)
+
+
+/*****************************************************************************/
+/* Local structures */
+/*****************************************************************************/
+struct sim_rx_frame {
+    uint64_t at_us;                             /**< end of frame on air */
+    uint8_t len;                                /**< payload length */
+    uint8_t rssi;                               /**< RSSI value */
+    uint8_t data[RFM69_SIM_FIFO_SIZE];          /**< payload */
+};
+
+struct sim_radio {
+    bool present;                               /**< reset by the HAL */
+    uint8_t regs[128];                          /**< register file */
+    uint8_t fifo[RFM69_SIM_FIFO_SIZE];          /**< FIFO */
+    uint8_t fifo_len;                           /**< FIFO fill level */
+    uint8_t fifo_pos;                           /**< FIFO read position */
+    bool fifo_overrun;                          /**< FIFO overrun flag */
+    bool packet_sent;                           /**< PacketSent flag */
+    bool payload_ready;                         /**< PayloadReady flag */
+    uint8_t mode;                               /**< current mode */
+    bool auto_active;                           /**< in AutoModes intermediate mode */
+    bool cycle_active;                          /**< TX cycle measurement ongoing */
+    uint64_t cycle_start_us;                    /**< first FIFO write of TX cycle */
+    uint64_t cycle_tx_end_us;                   /**< end of TX of cycle */
+    uint64_t mode_ready_us;                     /**< ModeReady timestamp */
+    uint64_t rx_armed_us;                       /**< RX ready since */
+    uint64_t tx_end_us;                         /**< end of transmission */
+    bool tx_active;                             /**< transmission ongoing */
+    bool selected;                              /**< slave selected */
+    bool addr_phase;                            /**< next byte is address */
+    bool write;                                 /**< write transaction */
+    uint8_t addr;                               /**< current address */
+    struct sim_rx_frame rx_queue[RFM69_SIM_RX_QUEUE_SIZE]; /**< RX queue */
+    uint8_t rx_queue_cnt;                       /**< queued RX frames */
+    struct rfm69_sim_stats stats;               /**< statistics */
+};
+
+
+/*****************************************************************************/
+/* Local variables */
+/*****************************************************************************/
+static struct sim_radio sim_radios[RFM69_SIM_RADIOS]; /**< transceivers */
+static uint64_t sim_now_us;                     /**< current time */
+static void (*sim_tx_hook)(uint8_t radio, const uint8_t *data, uint8_t len, uint64_t now_us);
+static void (*sim_rx_hook)(uint8_t radio, const uint8_t *data, uint8_t len, uint64_t now_us);
+
+/** AutoModes IntermediateMode to RegOpMode mode mapping */
+static const uint8_t sim_intermediate_modes[] = {
+    0,                                          /* sleep */
+    RFM69_OPMODE_STANDBY,
+    RFM69_OPMODE_RX,
+    RFM69_OPMODE_TX,
+};
+
+
+/*****************************************************************************/
+/** Reset Register File To Power-On Defaults
+ */
+void rfm69_sim_reset(
+    uint8_t radio                               /**< transceiver index */
+)
+{
+    struct sim_radio *sim = &sim_radios[radio];
+    static const uint8_t defaults[][2] = {
+        { RFM69_REG_OPMODE, 0x04 },
+        { RFM69_REG_BITRATEMSB, 0x1a },
+        { RFM69_REG_BITRATELSB, 0x0b },
+        { RFM69_REG_FDEVMSB, 0x00 },
+        { RFM69_REG_FDEVLSB, 0x52 },
+        { RFM69_REG_FRFMSB, 0xe4 },
+        { RFM69_REG_FRFMID, 0xc0 },
+        { RFM69_REG_FRFLSB, 0x00 },
+        { 0x10, 0x24 },                         /* RegVersion */
+        { RFM69_REG_PALEVEL, 0x9f },
+        { 0x12, 0x09 },                         /* RegPaRamp */
+        { RFM69_REG_OCP, 0x1a },
+        { RFM69_REG_RXBW, 0x86 },
+        { RFM69_REG_DIOMAPPING2, 0x05 },
+        { SIM_REG_RSSIVALUE, 0xff },
+        { RFM69_REG_RSSITHRESH, 0xff },
+        { SIM_REG_PREAMBLELSB, 0x03 },
+        { RFM69_REG_SYNCCONFIG, 0x98 },
+        { RFM69_REG_PACKETCONFIG1, 0x10 },
+        { RFM69_REG_PAYLOADLENGTH, 0x40 },
+        { RFM69_REG_FIFOTHRESH, 0x0f },
+        { RFM69_REG_PACKETCONFIG2, 0x02 },
+        { RFM69_REG_TESTPA1, RFM69_PA20DBM1_NORMAL },
+        { RFM69_REG_TESTPA2, RFM69_PA20DBM2_NORMAL },
+    };
+    unsigned int cnt;
+
+    memset(sim, 0, sizeof(*sim));
+    sim->present = true;
+    for (cnt = 0; cnt < 8; cnt++) {
+        sim->regs[RFM69_REG_SYNCVALUE1 + cnt] = 0x01;
+    }
+    for (cnt = 0; cnt < sizeof(defaults) / sizeof(defaults[0]); cnt++) {
+        sim->regs[defaults[cnt][0]] = defaults[cnt][1];
+    }
+
+    sim->fifo_len = sim->fifo_pos = 0;
+    sim->fifo_overrun = sim->packet_sent = sim->payload_ready = false;
+    sim->mode = RFM69_OPMODE_STANDBY;
+    sim->mode_ready_us = sim_now_us;
+    sim->tx_active = false;
+    sim->auto_active = false;
+    sim->cycle_active = false;
+    sim->selected = false;
+    sim->rx_queue_cnt = 0;
+}
+
+
+/*****************************************************************************/
+/* Local prototypes */
+/*****************************************************************************/
+static void sim_mode_set(
+    struct sim_radio *sim,                      /**< transceiver */
+    uint8_t mode                                /**< new mode */
+);
+
+
+/*****************************************************************************/
+/** Current Mode Is Ready
+ */
+static bool sim_mode_ready(
+    struct sim_radio *sim                       /**< transceiver */
+)
+{
+    return sim_now_us >= sim->mode_ready_us;
+}
+
+
+/*****************************************************************************/
+/** Empty FIFO
+ */
+static void sim_fifo_flush(
+    struct sim_radio *sim                       /**< transceiver */
+)
+{
+    sim->fifo_len = sim->fifo_pos = 0;
+    sim->payload_ready = false;
+}
+
+
+/*****************************************************************************/
+/** Airtime Of A Frame In Microseconds
+ */
+static uint32_t sim_airtime_us(
+    struct sim_radio *sim,                      /**< transceiver */
+    uint8_t len                                 /**< payload length */
+)
+{
+    uint32_t bits;
+    uint32_t bitrate;
+
+    bits = ((uint32_t) sim->regs[SIM_REG_PREAMBLEMSB] << 8) | sim->regs[SIM_REG_PREAMBLELSB];
+    if (sim->regs[RFM69_REG_SYNCCONFIG] & 0x80) {
+        bits += ((sim->regs[RFM69_REG_SYNCCONFIG] >> RFM69_SHF_SYNCCONFIG_SYNCSIZE) & RFM69_MSK_SYNCCONFIG_SYNCSIZE) + 1;
+    }
+    bits = (bits + len) * 8;
+
+    bitrate = ((uint32_t) sim->regs[RFM69_REG_BITRATEMSB] << 8) | sim->regs[RFM69_REG_BITRATELSB];
+    if (!bitrate) {
+        bitrate = 1;
+    }
+
+    /* bit time is bitrate register value / 32 MHz */
+    return (uint32_t) (((uint64_t) bits * bitrate) / 32);
+}
+
+
+/*****************************************************************************/
+/** Start Transmission If Start Condition Is Met
+ */
+static void sim_tx_check_start(
+    struct sim_radio *sim                       /**< transceiver */
+)
+{
+    bool start;
+
+    if ((RFM69_OPMODE_TX != sim->mode) || sim->tx_active || sim->packet_sent || !sim_mode_ready(sim)) {
+        return;
+    }
+
+    if (sim->regs[RFM69_REG_FIFOTHRESH] & 0x80) {
+        start = (sim->fifo_len > 0);
+    } else {
+        start = (sim->fifo_len > (sim->regs[RFM69_REG_FIFOTHRESH] & 0x7f));
+    }
+
+    if (start) {
+        sim->tx_active = true;
+        sim->tx_end_us = sim_now_us + sim_airtime_us(sim, sim->regs[RFM69_REG_PAYLOADLENGTH]);
+    }
+}
+
+
+/*****************************************************************************/
+/** Finish Transmission
+ */
+static void sim_tx_finish(
+    struct sim_radio *sim                       /**< transceiver */
+)
+{
+    uint8_t len = sim->regs[RFM69_REG_PAYLOADLENGTH];
+
+    if (len > sim->fifo_len) {
+        len = sim->fifo_len;
+    }
+
+    sim->tx_active = false;
+    sim->packet_sent = true;
+    sim->stats.tx_frames++;
+
+    if (sim_tx_hook) {
+        sim_tx_hook(sim - sim_radios, sim->fifo, len, sim_now_us);
+    }
+
+    sim_fifo_flush(sim);
+    sim->cycle_tx_end_us = sim_now_us;
+
+    /* AutoModes: leave intermediate mode on PacketSent */
+    if (sim->auto_active
+        && (SIM_AUTOMODES_EXIT_PACKETSENT == ((sim->regs[SIM_REG_AUTOMODES] >> 2) & 0x07))) {
+        sim->auto_active = false;
+        sim_mode_set(sim, (sim->regs[RFM69_REG_OPMODE] >> RFM69_SHF_OPMODE_MODE) & RFM69_MSK_OPMODE_MODE);
+    }
+}
+
+
+/*****************************************************************************/
+/** Record TX Cycle Once The Receiver Is Ready Again
+ *
+ * A cycle starts when the transceiver leaves RX and ends when it is ready to
+ * receive again after a frame was sent.
+ */
+static void sim_cycle_check(
+    struct sim_radio *sim                       /**< transceiver */
+)
+{
+    uint64_t cycle;
+
+    if (!sim->cycle_active || sim->tx_active || sim->auto_active || !sim->cycle_tx_end_us
+        || (RFM69_OPMODE_RX != sim->mode) || !sim_mode_ready(sim)) {
+        return;
+    }
+
+    cycle = sim->mode_ready_us - sim->cycle_start_us;
+    sim->stats.tx_cycles++;
+    sim->stats.tx_cycle_us += cycle;
+    sim->stats.tx_rearm_us += sim->mode_ready_us - sim->cycle_tx_end_us;
+    if (cycle > sim->stats.tx_cycle_max_us) {
+        sim->stats.tx_cycle_max_us = cycle;
+    }
+    sim->cycle_active = false;
+}
+
+
+/*****************************************************************************/
+/** Deliver Scheduled RX Frames
+ */
+static void sim_rx_deliver(
+    struct sim_radio *sim                       /**< transceiver */
+)
+{
+    struct sim_rx_frame *frame;
+    uint8_t len;
+
+    while (sim->rx_queue_cnt && (sim->rx_queue[0].at_us <= sim_now_us)) {
+        frame = &sim->rx_queue[0];
+
+        /* receiver must have listened during the whole frame */
+        if ((RFM69_OPMODE_RX == sim->mode) && sim_mode_ready(sim) && !sim->payload_ready
+            && (sim->rx_armed_us + sim_airtime_us(sim, frame->len) <= frame->at_us)) {
+
+            len = sim->regs[RFM69_REG_PAYLOADLENGTH];
+            if (len > RFM69_SIM_FIFO_SIZE) {
+                len = RFM69_SIM_FIFO_SIZE;
+            }
+
+            memset(sim->fifo, 0, sizeof(sim->fifo));
+            memcpy(sim->fifo, frame->data, (frame->len < len) ? frame->len : len);
+            sim->fifo_len = len;
+            sim->fifo_pos = 0;
+            sim->payload_ready = true;
+            sim->regs[SIM_REG_RSSIVALUE] = frame->rssi;
+            sim->stats.rx_frames++;
+
+            if (sim_rx_hook) {
+                sim_rx_hook(sim - sim_radios, frame->data, frame->len, sim_now_us);
+            }
+        } else {
+            sim->stats.rx_lost++;
+        }
+
+        sim->rx_queue_cnt--;
+        memmove(&sim->rx_queue[0], &sim->rx_queue[1], sim->rx_queue_cnt * sizeof(sim->rx_queue[0]));
+    }
+}
+
+
+/*****************************************************************************/
+/** Advance Simulation Time
+ */
+void rfm69_sim_tick(
+    uint64_t now_us                             /**< current time */
+)
+{
+    struct sim_radio *sim;
+
+    sim_now_us = now_us;
+
+    for (sim = sim_radios; sim < &sim_radios[RFM69_SIM_RADIOS]; sim++) {
+        if (!sim->present) {
+            continue;
+        }
+
+        sim_tx_check_start(sim);
+        if (sim->tx_active && (sim->tx_end_us <= sim_now_us)) {
+            sim_tx_finish(sim);
+        }
+
+        sim_rx_deliver(sim);
+        sim_cycle_check(sim);
+    }
+}
+
+
+/*****************************************************************************/
+/** Set Operation Mode
+ */
+static void sim_mode_set(
+    struct sim_radio *sim,                      /**< transceiver */
+    uint8_t mode                                /**< new mode */
+)
+{
+    if (mode == sim->mode) {
+        return;
+    }
+
+    /* leaving TX aborts transmission and clears PacketSent */
+    if (RFM69_OPMODE_TX == sim->mode) {
+        sim->tx_active = false;
+        sim->packet_sent = false;
+    }
+
+    /* leaving RX starts a TX cycle measurement */
+    if ((RFM69_OPMODE_RX == sim->mode) && !sim->cycle_active) {
+        sim->cycle_active = true;
+        sim->cycle_start_us = sim_now_us;
+        sim->cycle_tx_end_us = 0;
+    }
+
+    sim->mode = mode;
+    sim->stats.mode_changes++;
+
+    switch (mode) {
+        case RFM69_OPMODE_TX:
+            sim->mode_ready_us = sim_now_us + SIM_MODE_READY_TX_US;
+            break;
+        case RFM69_OPMODE_RX:
+            sim->mode_ready_us = sim_now_us + SIM_MODE_READY_RX_US;
+            sim->rx_armed_us = sim->mode_ready_us;
+            break;
+        default:
+            sim->mode_ready_us = sim_now_us + SIM_MODE_READY_STANDBY_US;
+            break;
+    }
+}
+
+
+/*****************************************************************************/
+/** Register Read
+ */
+static uint8_t sim_reg_read(
+    struct sim_radio *sim,                      /**< transceiver */
+    uint8_t addr                                /**< register address */
+)
+{
+    uint8_t val;
+
+    sim->stats.reg_reads[addr]++;
+
+    switch (addr) {
+        case RFM69_REG_FIFO:
+            if (sim->fifo_pos >= sim->fifo_len) {
+                return 0;
+            }
+            val = sim->fifo[sim->fifo_pos++];
+            if (sim->fifo_pos >= sim->fifo_len) {
+                sim_fifo_flush(sim);
+
+                /* AutoRxRestartOn: receiver restarts after the FIFO is read */
+                if (RFM69_OPMODE_RX == sim->mode) {
+                    sim->rx_armed_us = sim_now_us;
+                }
+            }
+            return val;
+
+        case RFM69_REG_OPMODE:
+            return (sim->regs[addr] & ~(RFM69_MSK_OPMODE_MODE << RFM69_SHF_OPMODE_MODE))
+                   | (sim->mode << RFM69_SHF_OPMODE_MODE);
+
+        case RFM69_REG_IRQFLAGS1:
+            val = 0;
+            if (sim_mode_ready(sim)) {
+                val |= SIM_IRQFLAGS1_MODEREADY;
+                if (RFM69_OPMODE_RX == sim->mode) {
+                    val |= SIM_IRQFLAGS1_RXREADY;
+                }
+                if (RFM69_OPMODE_TX == sim->mode) {
+                    val |= SIM_IRQFLAGS1_TXREADY;
+                }
+            }
+            if (sim->auto_active) {
+                val |= SIM_IRQFLAGS1_AUTOMODE;
+            }
+            return val;
+
+        case RFM69_REG_IRQFLAGS2:
+            val = 0;
+            if ((sim->fifo_len - sim->fifo_pos) >= RFM69_SIM_FIFO_SIZE) {
+                val |= SIM_IRQFLAGS2_FIFOFULL;
+            }
+            if (sim->fifo_len > sim->fifo_pos) {
+                val |= SIM_IRQFLAGS2_FIFONOTEMPTY;
+            }
+            if (sim->fifo_overrun) {
+                val |= SIM_IRQFLAGS2_FIFOOVERRUN;
+            }
+            if (sim->packet_sent) {
+                val |= SIM_IRQFLAGS2_PACKETSENT;
+            }
+            if (sim->payload_ready) {
+                val |= SIM_IRQFLAGS2_PAYLOADREADY | SIM_IRQFLAGS2_CRCOK;
+            }
+            return val;
+
+        default:
+            return sim->regs[addr];
+    }
+}
+
+
+/*****************************************************************************/
+/** Register Write
+ */
+static void sim_reg_write(
+    struct sim_radio *sim,                      /**< transceiver */
+    uint8_t addr,                               /**< register address */
+    uint8_t val                                 /**< value */
+)
+{
+    sim->stats.reg_writes[addr]++;
+
+    switch (addr) {
+        case RFM69_REG_FIFO:
+            if (sim->fifo_len >= RFM69_SIM_FIFO_SIZE) {
+                sim->fifo_overrun = true;
+                return;
+            }
+            sim->fifo[sim->fifo_len++] = val;
+
+            /* AutoModes: enter intermediate mode on rising edge of FifoNotEmpty */
+            if ((1 == sim->fifo_len) && !sim->auto_active
+                && (SIM_AUTOMODES_ENTER_FIFONOTEMPTY == ((sim->regs[SIM_REG_AUTOMODES] >> 5) & 0x07))) {
+                sim->auto_active = true;
+                sim_mode_set(sim, sim_intermediate_modes[sim->regs[SIM_REG_AUTOMODES] & 0x03]);
+            }
+            return;
+
+        case RFM69_REG_OPMODE:
+            sim->regs[addr] = val;
+            sim->auto_active = false;
+            sim_mode_set(sim, (val >> RFM69_SHF_OPMODE_MODE) & RFM69_MSK_OPMODE_MODE);
+            return;
+
+        case RFM69_REG_IRQFLAGS1:
+            return;
+
+        case RFM69_REG_IRQFLAGS2:
+            /* writing FifoOverrun clears the FIFO */
+            if (val & SIM_IRQFLAGS2_FIFOOVERRUN) {
+                sim->fifo_overrun = false;
+                sim_fifo_flush(sim);
+            }
+            return;
+
+        case RFM69_REG_PACKETCONFIG2:
+            /* RxRestart is self-clearing */
+            if (val & (RFM69_MSK_PACKETCONFIG2_RXRESTART << RFM69_SHF_PACKETCONFIG2_RXRESTART)) {
+                sim->rx_armed_us = sim_now_us;
+            }
+            sim->regs[addr] = val & ~(RFM69_MSK_PACKETCONFIG2_RXRESTART << RFM69_SHF_PACKETCONFIG2_RXRESTART);
+            return;
+
+        case 0x10:                              /* RegVersion */
+        case SIM_REG_RSSIVALUE:
+            return;
+
+        default:
+            sim->regs[addr] = val;
+            return;
+    }
+}
+
+
+/*****************************************************************************/
+/** Slave Select
+ */
+void rfm69_sim_select(
+    uint8_t radio                               /**< transceiver index */
+)
+{
+    struct sim_radio *sim = &sim_radios[radio];
+    sim->selected = true;
+    sim->addr_phase = true;
+    sim->stats.spi_transactions++;
+}
+
+
+/*****************************************************************************/
+/** Slave Deselect
+ */
+void rfm69_sim_deselect(
+    uint8_t radio                               /**< transceiver index */
+)
+{
+    struct sim_radio *sim = &sim_radios[radio];
+    sim->selected = false;
+    sim_tx_check_start(sim);
+}
+
+
+/*****************************************************************************/
+/** SPI Byte Transfer
+ */
+uint8_t rfm69_sim_transfer(
+    uint8_t radio,                              /**< transceiver index */
+    uint8_t val                                 /**< value from master */
+)
+{
+    struct sim_radio *sim = &sim_radios[radio];
+    uint8_t ret = 0;
+
+    if (!sim->selected) {
+        return 0xff;
+    }
+
+    sim->stats.spi_bytes++;
+
+    if (sim->addr_phase) {
+        sim->addr_phase = false;
+        sim->write = (val & SPI_WRITE) ? true : false;
+        sim->addr = val & 0x7f;
+        return 0;
+    }
+
+    if (sim->write) {
+        sim_reg_write(sim, sim->addr, val);
+    } else {
+        ret = sim_reg_read(sim, sim->addr);
+    }
+
+    /* auto-increment except for FIFO access */
+    if (RFM69_REG_FIFO != sim->addr) {
+        sim->addr = (sim->addr + 1) & 0x7f;
+    }
+
+    return ret;
+}
+
+
+/*****************************************************************************/
+/** DIO0 Line Level
+ */
+bool rfm69_sim_dio0(
+    uint8_t radio                               /**< transceiver index */
+)
+{
+    struct sim_radio *sim = &sim_radios[radio];
+    uint8_t map = (sim->regs[RFM69_REG_DIOMAPPING1] >> 6) & RFM69_MSK_DIOMAPPING;
+
+    if (RFM69_OPMODE_RX == sim->mode) {
+        if (RFM69_DIO0_RX_CRCOK_TX_PACKETSENT == map) {
+            return sim->payload_ready;
+        }
+        if (RFM69_DIO0_RX_PAYLOADREADY_TX_TXREADY == map) {
+            return sim->payload_ready;
+        }
+    }
+    else if (RFM69_OPMODE_TX == sim->mode) {
+        if (RFM69_DIO0_RX_CRCOK_TX_PACKETSENT == map) {
+            return sim->packet_sent;
+        }
+        if (RFM69_DIO0_RX_PAYLOADREADY_TX_TXREADY == map) {
+            return sim_mode_ready(sim);
+        }
+    }
+
+    return false;
+}
+
+
+/*****************************************************************************/
+/** Peek Register Without Side Effects
+ */
+uint8_t rfm69_sim_reg(
+    uint8_t radio,                              /**< transceiver index */
+    uint8_t addr                                /**< register address */
+)
+{
+    struct sim_radio *sim = &sim_radios[radio];
+
+    return sim->regs[addr & 0x7f];
+}
+
+
+/*****************************************************************************/
+/** Airtime Of A Frame With The Current Configuration
+ */
+uint32_t rfm69_sim_airtime_us(
+    uint8_t radio,                              /**< transceiver index */
+    uint8_t len                                 /**< payload length */
+)
+{
+    return sim_airtime_us(&sim_radios[radio], len);
+}
+
+
+/*****************************************************************************/
+/** Transceiver Was Reset By The HAL
+ */
+bool rfm69_sim_present(
+    uint8_t radio                               /**< transceiver index */
+)
+{
+    return sim_radios[radio].present;
+}
+
+
+/*****************************************************************************/
+/** Schedule Frame For Reception
+ *
+ * Returns false if the queue is full or the transceiver is not fitted.
+ */
+bool rfm69_sim_rx_schedule(
+    uint8_t radio,                              /**< transceiver index */
+    uint64_t at_us,                             /**< end of frame on air */
+    const uint8_t *data,                        /**< frame payload */
+    uint8_t len,                                /**< payload length */
+    uint8_t rssi                                /**< RegRssiValue */
+)
+{
+    struct sim_radio *sim = &sim_radios[radio];
+    struct sim_rx_frame *frame;
+    int pos;
+
+    if (!sim->present) {
+        return false;
+    }
+
+    if (RFM69_SIM_RX_QUEUE_SIZE <= sim->rx_queue_cnt) {
+        return false;
+    }
+
+    if (len > RFM69_SIM_FIFO_SIZE) {
+        len = RFM69_SIM_FIFO_SIZE;
+    }
+
+    /* keep queue sorted by time */
+    for (pos = sim->rx_queue_cnt; (pos > 0) && (sim->rx_queue[pos - 1].at_us > at_us); pos--) {
+        sim->rx_queue[pos] = sim->rx_queue[pos - 1];
+    }
+
+    frame = &sim->rx_queue[pos];
+    frame->at_us = at_us;
+    frame->len = len;
+    frame->rssi = rssi;
+    memcpy(frame->data, data, len);
+    sim->rx_queue_cnt++;
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/** Register TX Hook
+ */
+void rfm69_sim_tx_hook(
+    void (*hook)(uint8_t radio, const uint8_t *data, uint8_t len, uint64_t now_us) /**< TX hook */
+)
+{
+    sim_tx_hook = hook;
+}
+
+
+/*****************************************************************************/
+/** Register RX Hook
+ *
+ * Called for every frame that made it into the FIFO.
+ */
+void rfm69_sim_rx_hook(
+    void (*hook)(uint8_t radio, const uint8_t *data, uint8_t len, uint64_t now_us) /**< RX hook */
+)
+{
+    sim_rx_hook = hook;
+}
+
+
+/*****************************************************************************/
+/** Get Statistics
+ */
+const struct rfm69_sim_stats * rfm69_sim_stats_get(
+    uint8_t radio                               /**< transceiver index */
+)
+{
+    struct sim_radio *sim = &sim_radios[radio];
+    return &sim->stats;
+}
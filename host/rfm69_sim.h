@@ -0,0 +1,112 @@
+/**
+ * @brief RFM69 Register-Level Simulator
+ *
+ * Models the parts of the RFM69 that the firmware relies on: the SPI register
+ * protocol with address auto-increment, RegOpMode and ModeReady timing, the
+ * 66 byte FIFO, RegIrqFlags1/2 and the DIO0 line. Transmitted and received
+ * frames are reported through hooks and frames can be scheduled for reception at a
+ * given time. Up to RFM69_SIM_RADIOS transceivers are simulated, addressed by
+ * their index.
+ *
+ * Copyright (c) 2017, Sven Bachmann <dev@mcbachmann.de>
+ *
+ * Licensed under the MIT license, see LICENSE for details.
+ */
+#ifndef RFM69_SIM_H
+#define RFM69_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*****************************************************************************/
+/* Defines */
+/*****************************************************************************/
+#define RFM69_SIM_FIFO_SIZE                         66
+#define RFM69_SIM_RX_QUEUE_SIZE                     16
+#define RFM69_SIM_RADIOS                            2
+
+
+/*****************************************************************************/
+/* Structures */
+/*****************************************************************************/
+struct rfm69_sim_stats {
+    uint32_t spi_transactions;                  /**< SS low/high cycles */
+    uint32_t spi_bytes;                         /**< transferred bytes */
+    uint32_t reg_reads[128];                    /**< reads per register */
+    uint32_t reg_writes[128];                   /**< writes per register */
+    uint32_t mode_changes;                      /**< RegOpMode changes */
+    uint32_t tx_frames;                         /**< frames sent */
+    uint32_t rx_frames;                         /**< frames received */
+    uint32_t rx_lost;                           /**< frames missed */
+    uint32_t tx_cycles;                         /**< FIFO write to RX ready cycles */
+    uint64_t tx_cycle_us;                       /**< sum of cycle durations */
+    uint32_t tx_cycle_max_us;                   /**< longest cycle */
+    uint64_t tx_rearm_us;                       /**< sum of TX end to RX ready */
+};
+
+
+/*****************************************************************************/
+/* Prototypes */
+/*****************************************************************************/
+void rfm69_sim_reset(
+    uint8_t radio                               /**< transceiver index */
+);
+
+void rfm69_sim_select(
+    uint8_t radio                               /**< transceiver index */
+);
+
+void rfm69_sim_deselect(
+    uint8_t radio                               /**< transceiver index */
+);
+
+uint8_t rfm69_sim_transfer(
+    uint8_t radio,                              /**< transceiver index */
+    uint8_t val                                 /**< value from master */
+);
+
+void rfm69_sim_tick(
+    uint64_t now_us                             /**< current time */
+);
+
+bool rfm69_sim_dio0(
+    uint8_t radio                               /**< transceiver index */
+);
+
+uint8_t rfm69_sim_reg(
+    uint8_t radio,                              /**< transceiver index */
+    uint8_t addr                                /**< register address */
+);
+
+uint32_t rfm69_sim_airtime_us(
+    uint8_t radio,                              /**< transceiver index */
+    uint8_t len                                 /**< payload length */
+);
+
+bool rfm69_sim_present(
+    uint8_t radio                               /**< transceiver index */
+);
+
+bool rfm69_sim_rx_schedule(
+    uint8_t radio,                              /**< transceiver index */
+    uint64_t at_us,                             /**< end of frame on air */
+    const uint8_t *data,                        /**< frame payload */
+    uint8_t len,                                /**< payload length */
+    uint8_t rssi                                /**< RegRssiValue */
+);
+
+void rfm69_sim_tx_hook(
+    void (*hook)(uint8_t radio, const uint8_t *data, uint8_t len, uint64_t now_us) /**< TX hook */
+);
+
+void rfm69_sim_rx_hook(
+    void (*hook)(uint8_t radio, const uint8_t *data, uint8_t len, uint64_t now_us) /**< RX hook */
+);
+
+const struct rfm69_sim_stats * rfm69_sim_stats_get(
+    uint8_t radio                               /**< transceiver index */
+);
+
+
+#endif /* RFM69_SIM_H */
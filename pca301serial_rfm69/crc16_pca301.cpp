@@ -0,0 +1,167 @@
+/**
+ * @brief PCA301 CRC16 (polynomial 0x8005, init 0, no reflection)
+ *
+ * The lookup tables are built by constexpr templates so the compiler emits
+ * them as constant data. Only C++11 is required (avr-gcc default).
+ *
+ * Copyright (c) 2017, Sven Bachmann <dev@mcbachmann.de>
+ *
+ * Licensed under the MIT license, see LICENSE for details.
+ */
+#include "hal.h"
+#include "crc16_pca301.h"
+
+
+/*****************************************************************************/
+/** Shift CRC By Given Number Of Bits (compile time)
+ */
+static constexpr uint16_t crc16_pca301_shift(
+    uint16_t crc,                               /**< CRC value */
+    uint8_t bits                                /**< bits to process */
+)
+{
+    return (bits) ? crc16_pca301_shift((crc & 0x8000) ? (uint16_t) ((crc << 1) ^ CRC16_PCA301_POLY)
+                                                      : (uint16_t) (crc << 1),
+                                       bits - 1)
+                  : crc;
+}
+
+
+#if CRC16_PCA301_IMPL != CRC16_PCA301_IMPL_BITWISE
+
+/*****************************************************************************/
+/** Table Entry (compile time)
+ *
+ * Byte tables process 8 bits per lookup, nibble tables 4 bits.
+ */
+static constexpr uint16_t crc16_pca301_entry(
+    uint16_t idx,                               /**< table index */
+    uint8_t bits                                /**< bits per lookup */
+)
+{
+    return crc16_pca301_shift(idx << (16 - bits), bits);
+}
+
+
+/*****************************************************************************/
+/** Table Storage
+ */
+template<uint16_t... vals>
+struct crc16_pca301_table {
+    static const uint16_t data[sizeof...(vals)];
+};
+
+template<uint16_t... vals>
+const uint16_t crc16_pca301_table<vals...>::data[sizeof...(vals)] PROGMEM = { vals... };
+
+
+/*****************************************************************************/
+/** Table Generator
+ *
+ * Recursively prepends entry cnt - 1 until all entries are generated.
+ */
+template<uint8_t bits, uint16_t cnt, uint16_t... vals>
+struct crc16_pca301_gen : crc16_pca301_gen<bits, cnt - 1, crc16_pca301_entry(cnt - 1, bits), vals...> {
+};
+
+template<uint8_t bits, uint16_t... vals>
+struct crc16_pca301_gen<bits, 0, vals...> {
+    typedef crc16_pca301_table<vals...> table;
+};
+
+#endif
+
+
+#if CRC16_PCA301_IMPL == CRC16_PCA301_IMPL_TABLE
+
+typedef crc16_pca301_gen<8, 256>::table crc16_pca301_tbl;
+
+static_assert(crc16_pca301_entry(1, 8) == CRC16_PCA301_POLY, "CRC table generator broken");
+
+
+/*****************************************************************************/
+/** Update CRC With One Byte
+ */
+static inline uint16_t crc16_pca301_step(
+    uint16_t crc,                               /**< running CRC */
+    uint8_t data                                /**< data byte */
+)
+{
+    return (crc << 8) ^ pgm_read_word(&crc16_pca301_tbl::data[(uint8_t) (crc >> 8) ^ data]);
+}
+
+#elif CRC16_PCA301_IMPL == CRC16_PCA301_IMPL_NIBBLE
+
+typedef crc16_pca301_gen<4, 16>::table crc16_pca301_tbl;
+
+static_assert(crc16_pca301_entry(1, 4) == CRC16_PCA301_POLY, "CRC table generator broken");
+
+
+/*****************************************************************************/
+/** Update CRC With One Byte
+ */
+static inline uint16_t crc16_pca301_step(
+    uint16_t crc,                               /**< running CRC */
+    uint8_t data                                /**< data byte */
+)
+{
+    crc = (crc << 4) ^ pgm_read_word(&crc16_pca301_tbl::data[(crc >> 12) ^ (data >> 4)]);
+    return (crc << 4) ^ pgm_read_word(&crc16_pca301_tbl::data[(crc >> 12) ^ (data & 0x0f)]);
+}
+
+#else
+
+
+/*****************************************************************************/
+/** Update CRC With One Byte
+ */
+static inline uint16_t crc16_pca301_step(
+    uint16_t crc,                               /**< running CRC */
+    uint8_t data                                /**< data byte */
+)
+{
+    return crc16_pca301_shift(crc ^ ((uint16_t) data << 8), 8);
+}
+
+#endif
+
+
+/*****************************************************************************/
+/** Update CRC With One Byte
+ */
+uint16_t crc16_pca301_update(
+    uint16_t crc,                               /**< running CRC */
+    uint8_t data                                /**< data byte */
+)
+{
+    return crc16_pca301_step(crc, data);
+}
+
+
+/*****************************************************************************/
+/** Update CRC With Data Block
+ */
+uint16_t crc16_pca301_block(
+    uint16_t crc,                               /**< running CRC */
+    const uint8_t *data,                        /**< data */
+    uint16_t len                                /**< data length */
+)
+{
+    for (; len; len--, data++) {
+        crc = crc16_pca301_step(crc, *data);
+    }
+
+    return crc;
+}
+
+
+/*****************************************************************************/
+/** Calculate CRC Of Data Block
+ */
+uint16_t crc16_pca301(
+    const uint8_t *data,                        /**< data */
+    uint16_t len                                /**< data length */
+)
+{
+    return crc16_pca301_block(0, data, len);
+}
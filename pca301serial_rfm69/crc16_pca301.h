@@ -0,0 +1,57 @@
+/**
+ * @brief PCA301 CRC16 (polynomial 0x8005, init 0, no reflection)
+ *
+ * The implementation is selected at compile time by defining
+ * CRC16_PCA301_IMPL to one of the values below:
+ *
+ *   CRC16_PCA301_IMPL_TABLE   - 256 entry table, 512 bytes flash (default)
+ *   CRC16_PCA301_IMPL_NIBBLE  - 16 entry table, 32 bytes flash
+ *   CRC16_PCA301_IMPL_BITWISE - no table, 8 shifts per byte
+ *
+ * The tables are generated by the compiler and placed in PROGMEM.
+ *
+ * Copyright (c) 2017, Sven Bachmann <dev@mcbachmann.de>
+ *
+ * Licensed under the MIT license, see LICENSE for details.
+ */
+#ifndef CRC16_PCA301_H
+#define CRC16_PCA301_H
+
+#include <stdint.h>
+
+
+/*****************************************************************************/
+/* Defines */
+/*****************************************************************************/
+#define CRC16_PCA301_IMPL_BITWISE                   0
+#define CRC16_PCA301_IMPL_NIBBLE                    1
+#define CRC16_PCA301_IMPL_TABLE                     2
+
+#ifndef CRC16_PCA301_IMPL
+#  define CRC16_PCA301_IMPL                         CRC16_PCA301_IMPL_TABLE
+#endif
+
+#define CRC16_PCA301_POLY                           0x8005
+
+
+/*****************************************************************************/
+/* Prototypes */
+/*****************************************************************************/
+uint16_t crc16_pca301_update(
+    uint16_t crc,                               /**< running CRC */
+    uint8_t data                                /**< data byte */
+);
+
+uint16_t crc16_pca301_block(
+    uint16_t crc,                               /**< running CRC */
+    const uint8_t *data,                        /**< data */
+    uint16_t len                                /**< data length */
+);
+
+uint16_t crc16_pca301(
+    const uint8_t *data,                        /**< data */
+    uint16_t len                                /**< data length */
+);
+
+
+#endif /* CRC16_PCA301_H */
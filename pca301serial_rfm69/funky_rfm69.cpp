@@ -14,111 +14,281 @@
  *
  * Licensed under the MIT license, see LICENSE for details.
  */
-#include <SPI.h>
 #include <limits.h>
+#include <string.h>
+#include "hal.h"
 #include "funky_rfm69.h"
 
 
 /*****************************************************************************/
 /* Local variables */
 /*****************************************************************************/
-static uint8_t rfm69_pin_spi_ss = 0;            /**< SPI slave select pin */
-static bool rfm69_var_len = 0;                  /**< variable length flag */
-static uint8_t rfm69_opmode = 0xff;             /**< operation mode */
 static uint64_t rfm69_ts64 = 0;                 /**< 64-bit timestamp */
-static bool rfm69_flg_isr = false;              /**< ISR flag */
-static bool rfm69_flg_is_hw = false;            /**< RFM69HW flag */
-static uint8_t rfm69_dio_mapping_rx_dio = 0xff; /**< RX DIO selector */
-static uint8_t rfm69_dio_mapping_rx_val;        /**< RX DIO value */
-static uint8_t rfm69_dio_mapping_tx_dio = 0xff; /**< TX DIO selector */
-static uint8_t rfm69_dio_mapping_tx_val;        /**< TX DIO value */
 
 
 /*****************************************************************************/
 /* Local prototypes */
 /*****************************************************************************/
 uint8_t rfm69_reg_read_raw(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t addr                                /**< register address */
 );
 
 void rfm69_reg_write_raw(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t addr,                               /**< register address */
     uint8_t val                                 /**< value */
 );
 
 uint8_t rfm69_reg_read(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t addr,                               /**< register address */
     uint8_t mask,                               /**< value mask */
     uint8_t shift                               /**< value shift */
 );
 
 void rfm69_reg_rw(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t addr,                               /**< register address */
     uint8_t mask,                               /**< value mask */
     uint8_t shift,                              /**< value shift */
     uint8_t val                                 /**< value */
 );
 
+static void rfm69_shadow_load(
+    struct rfm69 *dev                           /**< instance */
+);
+
+static uint8_t rfm69_reg_read_raw_spi(
+    struct rfm69 *dev,                          /**< instance */
+    uint8_t addr                                /**< register address */
+);
+
 
 /*****************************************************************************/
 /** RFM69 SPI Initialization
+ *
+ * Every transceiver needs its own slave select and DIO0 interrupt pin. The
+ * interrupt handler must call rfm69_isr() for this instance, see
+ * RFM69_INSTANCE().
  */
 void rfm69_init(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t pin_spi_ss,                         /**< SPI slave select pin */
+    uint8_t pin_irq,                            /**< DIO0 interrupt pin */
+    void (*irq_handler)(void),                  /**< DIO0 interrupt handler */
     uint8_t flg_is_rfm69hw                      /**< output power flag */
 )
 {
-    /* store pin for communication */
-    rfm69_pin_spi_ss = pin_spi_ss;
+    memset(dev, 0, sizeof(*dev));
+    dev->opmode = 0xff;
+    dev->dio_mapping_rx_dio = 0xff;
+    dev->dio_mapping_tx_dio = 0xff;
+    dev->tx_state = RFM69_SEND_STATE_IDLE;
+
+    /* store pins for communication */
+    dev->pin_spi_ss = pin_spi_ss;
+    dev->pin_irq = pin_irq;
+    dev->irq_handler = irq_handler;
+    hal_gpio_input(pin_irq);
 
     /* store variant for output power control */
-    rfm69_flg_is_hw = flg_is_rfm69hw;
+    dev->flg_is_hw = flg_is_rfm69hw;
 
     /* configure SPI */
-    pinMode(rfm69_pin_spi_ss, OUTPUT);
-    SPI.begin();
-    SPI.setBitOrder(MSBFIRST);
+    hal_spi_init(dev->pin_spi_ss);
+
+    /* fill register shadow */
+    rfm69_shadow_load(dev);
 
     /* configure power amplifiers in regard to the used variant */
     if (flg_is_rfm69hw) {
-        rfm69_pa_sel(RFM69_PA_1_ON | RFM69_PA_2_ON);
-        rfm69_ocp(false);
+        rfm69_pa_sel(dev, RFM69_PA_1_ON | RFM69_PA_2_ON);
+        rfm69_ocp(dev, false);
     } else {
-        rfm69_pa_sel(RFM69_PA_0_ON);
+        rfm69_pa_sel(dev, RFM69_PA_0_ON);
     }
 }
 
 
 /*****************************************************************************/
-/** RFM69 Read Full Register
+/** RFM69 Start SPI Transaction
  */
-uint8_t rfm69_reg_read_raw(
+static void rfm69_spi_begin(
+    struct rfm69 *dev,                          /**< instance */
+    uint8_t cmd                                 /**< address and write flag */
+)
+{
+    dev->spi_stats.transactions++;
+
+    hal_spi_select(dev->pin_spi_ss);
+    hal_spi_transfer(cmd);
+}
+
+
+/*****************************************************************************/
+/** RFM69 End SPI Transaction
+ */
+static void rfm69_spi_end(
+    struct rfm69 *dev                           /**< instance */
+)
+{
+    hal_spi_deselect(dev->pin_spi_ss);
+}
+
+
+/*****************************************************************************/
+/** RFM69 Register Shadow Index
+ *
+ * Returns RFM69_SHADOW_NONE for registers that the transceiver changes on
+ * its own (FIFO, status, measurements) or that aren't used by this library.
+ */
+static uint8_t rfm69_shadow_idx(
+    uint8_t addr                                /**< register address */
+)
+{
+    switch (addr) {
+        case RFM69_REG_FIFO:
+        case RFM69_REG_OSC1:
+        case RFM69_REG_IRQFLAGS1:
+        case RFM69_REG_IRQFLAGS2:
+            return RFM69_SHADOW_NONE;
+
+        case RFM69_REG_TESTPA1:
+            return RFM69_SHADOW_SIZE - 2;
+
+        case RFM69_REG_TESTPA2:
+            return RFM69_SHADOW_SIZE - 1;
+    }
+
+    /* AFC, FEI and RSSI results */
+    if ((RFM69_REG_AFCFEI <= addr) && (RFM69_REG_RSSIVALUE >= addr)) {
+        return RFM69_SHADOW_NONE;
+    }
+
+    if (RFM69_REG_PACKETCONFIG2 < addr) {
+        return RFM69_SHADOW_NONE;
+    }
+
+    return addr;
+}
+
+
+/*****************************************************************************/
+/** RFM69 Fill Register Shadow
+ *
+ * Reads 0x01..0x3d in one burst, the address auto-increments.
+ */
+static void rfm69_shadow_load(
+    struct rfm69 *dev                           /**< instance */
+)
+{
+    uint8_t addr;                               /* register address */
+
+    rfm69_spi_begin(dev, RFM69_REG_OPMODE);
+    for (addr = RFM69_REG_OPMODE; addr <= RFM69_REG_PACKETCONFIG2; addr++) {
+        dev->shadow[addr] = hal_spi_transfer(0);
+    }
+    rfm69_spi_end(dev);
+
+    /* RestartRx is a trigger and always reads 0 */
+    dev->shadow[RFM69_REG_PACKETCONFIG2] &= ~(RFM69_MSK_PACKETCONFIG2_RXRESTART << RFM69_SHF_PACKETCONFIG2_RXRESTART);
+
+    dev->shadow[rfm69_shadow_idx(RFM69_REG_TESTPA1)] = rfm69_reg_read_raw_spi(dev, RFM69_REG_TESTPA1);
+    dev->shadow[rfm69_shadow_idx(RFM69_REG_TESTPA2)] = rfm69_reg_read_raw_spi(dev, RFM69_REG_TESTPA2);
+}
+
+
+/*****************************************************************************/
+/** RFM69 Read Full Register From Transceiver
+ */
+static uint8_t rfm69_reg_read_raw_spi(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t addr                                /**< register address */
 )
 {
     uint8_t val;
 
-    digitalWrite(SS, LOW);
-    SPI.transfer(0x00 | addr);
-    val = SPI.transfer(0);
-    digitalWrite(SS, HIGH);
+    rfm69_spi_begin(dev, 0x00 | addr);
+    val = hal_spi_transfer(0);
+    rfm69_spi_end(dev);
 
     return val;
 }
 
 
+/*****************************************************************************/
+/** RFM69 Read Full Register
+ *
+ * Configuration registers are served from the shadow.
+ */
+uint8_t rfm69_reg_read_raw(
+    struct rfm69 *dev,                          /**< instance */
+    uint8_t addr                                /**< register address */
+)
+{
+    uint8_t idx = rfm69_shadow_idx(addr);       /* shadow index */
+
+    if (RFM69_SHADOW_NONE != idx) {
+        dev->spi_stats.skipped++;
+        return dev->shadow[idx];
+    }
+
+    return rfm69_reg_read_raw_spi(dev, addr);
+}
+
+
 /*****************************************************************************/
 /** RFM69 Write Full Register
+ *
+ * Writes of unchanged configuration registers are skipped. A set RestartRx
+ * bit always differs from the shadow, so restarts are never skipped.
  */
 void rfm69_reg_write_raw(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t addr,                               /**< register address */
     uint8_t val                                 /**< value */
 )
 {
-    digitalWrite(SS, LOW);
-    SPI.transfer(SPI_WRITE | addr);
-    SPI.transfer(val);
-    digitalWrite(SS, HIGH);
+    uint8_t idx = rfm69_shadow_idx(addr);       /* shadow index */
+
+    if (RFM69_SHADOW_NONE != idx) {
+        if (dev->shadow[idx] == val) {
+            dev->spi_stats.skipped++;
+            return;
+        }
+
+        dev->shadow[idx] = val;
+        if (RFM69_REG_PACKETCONFIG2 == addr) {
+            dev->shadow[idx] &= ~(RFM69_MSK_PACKETCONFIG2_RXRESTART << RFM69_SHF_PACKETCONFIG2_RXRESTART);
+        }
+    }
+
+    rfm69_spi_begin(dev, SPI_WRITE | addr);
+    hal_spi_transfer(val);
+    rfm69_spi_end(dev);
+}
+
+
+/*****************************************************************************/
+/** RFM69 Write Consecutive Registers
+ *
+ * Uses address auto-increment, so all registers are written in one SPI
+ * transaction. Only for cached registers in 0x01..0x3d.
+ */
+static void rfm69_reg_write_burst(
+    struct rfm69 *dev,                          /**< instance */
+    uint8_t addr,                               /**< first register address */
+    const uint8_t *vals,                        /**< values */
+    uint8_t len                                 /**< register count */
+)
+{
+    rfm69_spi_begin(dev, SPI_WRITE | addr);
+    for (; len; len--, addr++, vals++) {
+        dev->shadow[addr] = *vals;
+        hal_spi_transfer(*vals);
+    }
+    rfm69_spi_end(dev);
 }
 
 
@@ -126,28 +296,52 @@ void rfm69_reg_write_raw(
 /** RFM69 Read Register Value
  */
 uint8_t rfm69_reg_read(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t addr,                               /**< register address */
     uint8_t mask,                               /**< value mask */
     uint8_t shift                               /**< value shift */
 )
 {
-    return (rfm69_reg_read_raw(addr) >> shift) & mask;
+    return (rfm69_reg_read_raw(dev, addr) >> shift) & mask;
 }
 
 
 /*****************************************************************************/
 /** RFM69 Update Register Value
  *
- * Reads a register, updates the value and writes it back.
+ * Updates the value in the register shadow and writes it back.
  */
 void rfm69_reg_rw(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t addr,                               /**< register address */
     uint8_t mask,                               /**< value mask */
     uint8_t shift,                              /**< value shift */
     uint8_t val                                 /**< value */
 )
 {
-    rfm69_reg_write_raw(addr, (rfm69_reg_read_raw(addr) & ~(mask << shift)) | ((val & mask) << shift));
+    rfm69_reg_write_raw(dev, addr, (rfm69_reg_read_raw(dev, addr) & ~(mask << shift)) | ((val & mask) << shift));
+}
+
+
+/*****************************************************************************/
+/** RFM69 Interrupt Enable
+ */
+void rfm69_int_enable(
+    struct rfm69 *dev                           /**< instance */
+)
+{
+    hal_irq_attach(dev->pin_irq, dev->irq_handler, HAL_IRQ_RISING);
+}
+
+
+/*****************************************************************************/
+/** RFM69 Interrupt Disable
+ */
+void rfm69_int_disable(
+    struct rfm69 *dev                           /**< instance */
+)
+{
+    hal_irq_detach(dev->pin_irq);
 }
 
 
@@ -155,10 +349,11 @@ void rfm69_reg_rw(
 /** RFM69 Interrupt Handler
  */
 void rfm69_isr(
-    void
+    struct rfm69 *dev                           /**< instance */
 )
 {
-    rfm69_flg_isr = true;
+    dev->isr_ts = hal_millis();
+    dev->flg_isr = true;
 }
 
 
@@ -166,84 +361,181 @@ void rfm69_isr(
 /** RFM69 Get Operation Mode
  */
 uint8_t rfm69_opmode_get(
-    void
+    struct rfm69 *dev                           /**< instance */
 )
 {
     /* check if mode is already known */
-    if (0xff == rfm69_opmode) {
+    if (0xff == dev->opmode) {
 
         /* get mode */
-        rfm69_opmode = rfm69_reg_read(RFM69_REG_OPMODE,
-                                      RFM69_MSK_OPMODE_MODE,
-                                      RFM69_SHF_OPMODE_MODE);
+        dev->opmode = rfm69_reg_read(dev, RFM69_REG_OPMODE,
+                                     RFM69_MSK_OPMODE_MODE,
+                                     RFM69_SHF_OPMODE_MODE);
     }
 
-    return rfm69_opmode;
+    return dev->opmode;
 }
 
 
 /*****************************************************************************/
-/** RFM69 Set Operation Mode
+/** RFM69 Request Operation Mode
+ *
+ * Configures the DIO mapping for the new mode and requests the mode change
+ * without waiting for ModeReady.
  */
-void rfm69_opmode_set(
+static void rfm69_opmode_request(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t mode                                /**< transceiver mode */
 )
 {
-    uint64_t ts64;                              /* timeout timestamp */
-
     /* configure DIO mapping if set */
     if (RFM69_OPMODE_RX == mode) {
-        if (rfm69_dio_mapping_rx_dio != 0xff) {
-            rfm69_dio_mapping(rfm69_dio_mapping_rx_dio, rfm69_dio_mapping_rx_val);
+        if (dev->dio_mapping_rx_dio != 0xff) {
+            rfm69_dio_mapping(dev, dev->dio_mapping_rx_dio, dev->dio_mapping_rx_val);
         }
     }
     else if (RFM69_OPMODE_TX == mode) {
-        if (rfm69_dio_mapping_tx_dio != 0xff) {
-            rfm69_dio_mapping(rfm69_dio_mapping_tx_dio, rfm69_dio_mapping_tx_val);
+        if (dev->dio_mapping_tx_dio != 0xff) {
+            rfm69_dio_mapping(dev, dev->dio_mapping_tx_dio, dev->dio_mapping_tx_val);
         }
     }
 
     /* clear ISR flag */
-    rfm69_flg_isr = false;
+    dev->flg_isr = false;
 
     /* set mode */
-    rfm69_reg_rw(RFM69_REG_OPMODE,
+    rfm69_reg_rw(dev, RFM69_REG_OPMODE,
                  RFM69_MSK_OPMODE_MODE,
                  RFM69_SHF_OPMODE_MODE,
                  mode);
 
-    /* wait until mode is ready */
-    ts64 = rfm69_ts64 + RFM69_TIMEOUT_MS;
-    while (!rfm69_reg_read(RFM69_REG_IRQFLAGS1,
-                           RFM69_MSK_IRQFLAGS1_MODEREADY,
-                           RFM69_SHF_IRQFLAGS1_MODEREADY)) {
+    /* update global opmode, the FIFO must not be touched by RX handling
+     * from now on if the mode isn't RX
+     */
+    dev->opmode = mode;
+}
+
+
+/*****************************************************************************/
+/** RFM69 Operation Mode Ready Check
+ */
+static bool rfm69_opmode_ready(
+    struct rfm69 *dev                           /**< instance */
+)
+{
+    return rfm69_reg_read(dev, RFM69_REG_IRQFLAGS1,
+                          RFM69_MSK_IRQFLAGS1_MODEREADY,
+                          RFM69_SHF_IRQFLAGS1_MODEREADY) ? true : false;
+}
 
-        rfm69_timer_loop();
-        if (rfm69_ts64 >= ts64) {
-            Serial.println("opmode: timeout");
-            break;
-        }
-    }
 
+/*****************************************************************************/
+/** RFM69 Finish Operation Mode Change
+ *
+ * Called once the requested mode is ready.
+ */
+static void rfm69_opmode_finish(
+    struct rfm69 *dev,                          /**< instance */
+    uint8_t mode                                /**< transceiver mode */
+)
+{
     /* enable high power output for RFM69HW if mode is TX */
-    if (rfm69_flg_is_hw) {
+    if (dev->flg_is_hw) {
         if (RFM69_OPMODE_TX == mode) {
-            rfm69_high_power_pa(true);
+            rfm69_high_power_pa(dev, true);
         } else {
-            rfm69_high_power_pa(false);
+            rfm69_high_power_pa(dev, false);
         }
     }
 
     /* restart RX if mode is RX */
     if (RFM69_OPMODE_RX == mode) {
-        rfm69_reg_rw(RFM69_REG_PACKETCONFIG2,
+        rfm69_reg_rw(dev, RFM69_REG_PACKETCONFIG2,
                      RFM69_MSK_PACKETCONFIG2_RXRESTART,
                      RFM69_SHF_PACKETCONFIG2_RXRESTART,
                      RFM69_RXRESTART);
     }
+}
+
 
-    /* update global opmode */
-    rfm69_opmode = mode;
+/*****************************************************************************/
+/** RFM69 Set Operation Mode
+ */
+void rfm69_opmode_set(
+    struct rfm69 *dev,                          /**< instance */
+    uint8_t mode                                /**< transceiver mode */
+)
+{
+    uint64_t ts64;                              /* timeout timestamp */
+
+    rfm69_opmode_request(dev, mode);
+
+    /* wait until mode is ready */
+    ts64 = rfm69_ts64 + RFM69_TIMEOUT_MS;
+    while (!rfm69_opmode_ready(dev)) {
+
+        rfm69_timer_loop();
+        if (rfm69_ts64 >= ts64) {
+            dev->err_stats.opmode_timeouts++;
+            break;
+        }
+    }
+
+    rfm69_opmode_finish(dev, mode);
+}
+
+
+/*****************************************************************************/
+/** RFM69 Apply Configuration Table
+ *
+ * Merges all fields into the register shadow first and then writes every
+ * run of changed registers with a single burst. Registers outside the
+ * shadow are written directly with the field value.
+ */
+void rfm69_config(
+    struct rfm69 *dev,                          /**< instance */
+    const struct rfm69_reg_field *fields,       /**< field table in PROGMEM */
+    uint8_t cnt                                 /**< field count */
+)
+{
+    uint8_t dirty[(RFM69_REG_PACKETCONFIG2 + 8) / 8] = { 0 }; /* changed registers */
+    uint8_t addr;                               /* register address */
+    uint8_t mask;                               /* field mask */
+    uint8_t val;                                /* register value */
+    uint8_t start;                              /* start of changed run */
+
+    /* merge fields into shadow */
+    for (; cnt; cnt--, fields++) {
+        addr = pgm_read_byte(&fields->addr);
+        mask = pgm_read_byte(&fields->mask);
+        val = pgm_read_byte(&fields->val);
+
+        if ((RFM69_REG_PACKETCONFIG2 < addr) || (addr != rfm69_shadow_idx(addr))) {
+            rfm69_reg_write_raw(dev, addr, val);
+            continue;
+        }
+
+        val = (dev->shadow[addr] & ~mask) | val;
+        if (val != dev->shadow[addr]) {
+            dev->shadow[addr] = val;
+            dirty[addr >> 3] |= 1 << (addr & 7);
+        }
+    }
+
+    /* write runs of changed registers */
+    addr = RFM69_REG_OPMODE;
+    while (addr <= RFM69_REG_PACKETCONFIG2) {
+        if (!(dirty[addr >> 3] & (1 << (addr & 7)))) {
+            addr++;
+            continue;
+        }
+
+        start = addr;
+        while ((addr <= RFM69_REG_PACKETCONFIG2) && (dirty[addr >> 3] & (1 << (addr & 7)))) {
+            addr++;
+        }
+        rfm69_reg_write_burst(dev, start, &dev->shadow[start], addr - start);
+    }
 }
 
 
@@ -253,16 +545,15 @@ void rfm69_opmode_set(
  * Example: 868000 for 868 MHz.
  */
 void rfm69_freq_carrier_khz(
+    struct rfm69 *dev,                          /**< instance */
     uint32_t freq_khz                           /**< carrier frequency in kHz */
 )
 {
-    uint32_t frf;                               /* carrier frequency register value */
+    uint32_t frf = rfm69_frf_reg(freq_khz);     /* carrier frequency register value */
+    uint8_t vals[3] = { (uint8_t) (frf >> 16), (uint8_t) (frf >> 8), (uint8_t) frf };
 
-    frf = freq_khz / (RFM69_FREQ_FSTEP_HZ / RFM69_UNIT_KILO);
-
-    rfm69_reg_write_raw(RFM69_REG_FRFMSB, (uint8_t) (frf >> 16));
-    rfm69_reg_write_raw(RFM69_REG_FRFMID, (uint8_t) (frf >> 8));
-    rfm69_reg_write_raw(RFM69_REG_FRFLSB, (uint8_t) frf);
+    /* the new frequency is taken over with the LSB write */
+    rfm69_reg_write_burst(dev, RFM69_REG_FRFMSB, vals, sizeof(vals));
 }
 
 
@@ -272,15 +563,14 @@ void rfm69_freq_carrier_khz(
  * Example: 6631 for 6.631 kb/s.
  */
 void rfm69_bitrate_bs(
+    struct rfm69 *dev,                          /**< instance */
     uint16_t bitrate_bs                         /**< bitrate in b/s */
 )
 {
-    uint16_t bitrate;                           /* bitrate register value */
-
-    bitrate = RFM69_FREQ_FXOSC_HZ / bitrate_bs;
+    uint16_t bitrate = rfm69_bitrate_reg(bitrate_bs); /* bitrate register value */
+    uint8_t vals[2] = { (uint8_t) (bitrate >> 8), (uint8_t) bitrate };
 
-    rfm69_reg_write_raw(RFM69_REG_BITRATEMSB, (uint8_t) (bitrate >> 8));
-    rfm69_reg_write_raw(RFM69_REG_BITRATELSB, (uint8_t) bitrate);
+    rfm69_reg_write_burst(dev, RFM69_REG_BITRATEMSB, vals, sizeof(vals));
 }
 
 
@@ -288,12 +578,13 @@ void rfm69_bitrate_bs(
 /** RFM69 DIO Pin Mapping for RX
  */
 void rfm69_dio_mapping_rx(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t dio,                                /**< DIO number */
     uint8_t val                                 /**< map value */
 )
 {
-    rfm69_dio_mapping_rx_dio = dio;
-    rfm69_dio_mapping_rx_val = val;
+    dev->dio_mapping_rx_dio = dio;
+    dev->dio_mapping_rx_val = val;
 }
 
 
@@ -301,12 +592,13 @@ void rfm69_dio_mapping_rx(
 /** RFM69 DIO Pin Mapping for TX
  */
 void rfm69_dio_mapping_tx(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t dio,                                /**< DIO number */
     uint8_t val                                 /**< map value */
 )
 {
-    rfm69_dio_mapping_tx_dio = dio;
-    rfm69_dio_mapping_tx_val = val;
+    dev->dio_mapping_tx_dio = dio;
+    dev->dio_mapping_tx_val = val;
 }
 
 
@@ -314,6 +606,7 @@ void rfm69_dio_mapping_tx(
 /** RFM69 DIO Pin Mapping
  */
 void rfm69_dio_mapping(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t dio,                                /**< DIO number */
     uint8_t val                                 /**< map value */
 )
@@ -329,7 +622,7 @@ void rfm69_dio_mapping(
         shift = 6 - ((dio - 4) * 2);
     }
 
-    rfm69_reg_rw(reg, RFM69_MSK_DIOMAPPING, shift, val);
+    rfm69_reg_rw(dev, reg, RFM69_MSK_DIOMAPPING, shift, val);
 }
 
 
@@ -337,10 +630,11 @@ void rfm69_dio_mapping(
 /** RFM69 Control CLKOUT
  */
 void rfm69_clkout(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t clkout                              /**< CLKOUT config */
 )
 {
-    rfm69_reg_rw(RFM69_REG_DIOMAPPING2,
+    rfm69_reg_rw(dev, RFM69_REG_DIOMAPPING2,
                  RFM69_MSK_DIOMAPPING2_CLKOUT,
                  RFM69_SHF_DIOMAPPING2_CLKOUT,
                  clkout);
@@ -351,10 +645,11 @@ void rfm69_clkout(
 /** RFM69 CRC Calculation Control
  */
 void rfm69_crc_on(
+    struct rfm69 *dev,                          /**< instance */
     bool on                                     /**< CRC calculation on flag */
 )
 {
-    rfm69_reg_rw(RFM69_REG_PACKETCONFIG1,
+    rfm69_reg_rw(dev, RFM69_REG_PACKETCONFIG1,
                  RFM69_MSK_PACKETCONFIG1_CRCON,
                  RFM69_SHF_PACKETCONFIG1_CRCON,
                  (on) ? 1 : 0);
@@ -365,10 +660,11 @@ void rfm69_crc_on(
 /** RFM69 CRC Auto Clear Control
  */
 void rfm69_crc_auto_clear_off(
+    struct rfm69 *dev,                          /**< instance */
     bool off                                    /**< CRC auto clear off flag */
 )
 {
-    rfm69_reg_rw(RFM69_REG_PACKETCONFIG1,
+    rfm69_reg_rw(dev, RFM69_REG_PACKETCONFIG1,
                  RFM69_MSK_PACKETCONFIG1_CRCAUTOCLEAROFF,
                  RFM69_SHF_PACKETCONFIG1_CRCAUTOCLEAROFF,
                  (off) ? 1 : 0);
@@ -379,10 +675,11 @@ void rfm69_crc_auto_clear_off(
 /** RFM69 Payload Length
  */
 void rfm69_payload_length(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t len                                 /**< payload length */
 )
 {
-    rfm69_reg_write_raw(RFM69_REG_PAYLOADLENGTH, len);
+    rfm69_reg_write_raw(dev, RFM69_REG_PAYLOADLENGTH, len);
 }
 
 
@@ -390,10 +687,11 @@ void rfm69_payload_length(
 /** RFM69 Sync Word Generation And Detection
  */
 void rfm69_sync_on(
+    struct rfm69 *dev,                          /**< instance */
     bool on                                     /**< sync on flag */
 )
 {
-    rfm69_reg_rw(RFM69_REG_SYNCCONFIG,
+    rfm69_reg_rw(dev, RFM69_REG_SYNCCONFIG,
                  RFM69_MSK_SYNCCONFIG_SYNCON,
                  RFM69_SHF_SYNCCONFIG_SYNCON,
                  (on) ? 1 : 0);
@@ -404,22 +702,19 @@ void rfm69_sync_on(
 /** RFM69 Sync Word Size
  */
 void rfm69_sync_word(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t size,                               /**< sync word size */
     uint8_t *values                             /**< sync values */
 )
 {
-    unsigned int cnt;                           /* counter */
-
     /* sync size always add +1 so decrement size here */
-    rfm69_reg_rw(RFM69_REG_SYNCCONFIG,
+    rfm69_reg_rw(dev, RFM69_REG_SYNCCONFIG,
                  RFM69_MSK_SYNCCONFIG_SYNCSIZE,
                  RFM69_SHF_SYNCCONFIG_SYNCSIZE,
                  size - 1);
 
     /* fill sync values */
-    for (cnt = 0; cnt < size; cnt++) {
-        rfm69_reg_write_raw(RFM69_REG_SYNCVALUE1 + cnt, values[cnt]);
-    }
+    rfm69_reg_write_burst(dev, RFM69_REG_SYNCVALUE1, values, size);
 }
 
 
@@ -427,10 +722,11 @@ void rfm69_sync_word(
 /** RFM69 Channel Filter Bandwidth Control
  */
 void rfm69_rx_bw_exp(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t exp                                 /**< exponent */
 )
 {
-    rfm69_reg_rw(RFM69_REG_RXBW,
+    rfm69_reg_rw(dev, RFM69_REG_RXBW,
                  RFM69_MSK_RXBW_RXBWEXP,
                  RFM69_SHF_RXBW_RXBWEXP,
                  exp);
@@ -443,10 +739,11 @@ void rfm69_rx_bw_exp(
  * Default: 228 (0xe4) => 228 / 2 = -114 dBm
  */
 void rfm69_rssi_threshold(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t threshold                           /**< threshold */
 )
 {
-    rfm69_reg_write_raw(RFM69_REG_RSSITHRESH, threshold);
+    rfm69_reg_write_raw(dev, RFM69_REG_RSSITHRESH, threshold);
 }
 
 
@@ -454,10 +751,10 @@ void rfm69_rssi_threshold(
 /** RFM69 Clear Fifo
  */
 void rfm69_fifo_clear(
-    void
+    struct rfm69 *dev                           /**< instance */
 )
 {
-    rfm69_reg_write_raw(RFM69_REG_IRQFLAGS2,
+    rfm69_reg_write_raw(dev, RFM69_REG_IRQFLAGS2,
                         RFM69_MSK_IRQFLAGS2_FIFOOVERRUN << RFM69_SHF_IRQFLAGS2_FIFOOVERRUN);
 }
 
@@ -466,10 +763,10 @@ void rfm69_fifo_clear(
 /** RFM69 Fifo Data Available
  */
 bool rfm69_fifo_data_avail(
-    void
+    struct rfm69 *dev                           /**< instance */
 )
 {
-    return (rfm69_reg_read(RFM69_REG_IRQFLAGS2,
+    return (rfm69_reg_read(dev, RFM69_REG_IRQFLAGS2,
                            RFM69_MSK_IRQFLAGS2_PAYLOADREADY,
                            RFM69_SHF_IRQFLAGS2_PAYLOADREADY)) ? true : false;
 }
@@ -479,66 +776,239 @@ bool rfm69_fifo_data_avail(
 /** RFM69 Fifo Data
  */
 uint8_t rfm69_fifo_data(
-    void
+    struct rfm69 *dev                           /**< instance */
 )
 {
-    return rfm69_reg_read_raw(RFM69_REG_FIFO);
+    return rfm69_reg_read_raw(dev, RFM69_REG_FIFO);
 }
 
 
 /*****************************************************************************/
-/** RFM69 Send Data
+/** RFM69 Fifo Burst Read
  *
- * Send given data and switch back to RX mode.
+ * Reads up to len bytes from the FIFO in a single SPI transaction. The FIFO
+ * address doesn't auto-increment so every byte is taken from the FIFO.
+ * Returns the number of bytes read.
  */
-void rfm69_send(
+uint8_t rfm69_fifo_read_burst(
+    struct rfm69 *dev,                          /**< instance */
+    uint8_t *buf,                               /**< destination buffer */
+    uint8_t len                                 /**< bytes to read */
+)
+{
+    uint8_t cnt;                                /* counter */
+
+    if (RFM69_FIFO_SIZE < len) {
+        len = RFM69_FIFO_SIZE;
+    }
+
+    rfm69_spi_begin(dev, RFM69_REG_FIFO);
+
+    for (cnt = 0; cnt < len; cnt++) {
+        buf[cnt] = hal_spi_transfer(0);
+    }
+    rfm69_spi_end(dev);
+
+    return len;
+}
+
+
+/*****************************************************************************/
+/** RFM69 Write Send Buffer To Fifo
+ */
+static void rfm69_send_fifo_write(
+    struct rfm69 *dev                           /**< instance */
+)
+{
+    uint8_t cnt;                                /* counter */
+
+    rfm69_int_disable(dev);
+
+    rfm69_spi_begin(dev, SPI_WRITE | RFM69_REG_FIFO);
+
+    for (cnt = 0; cnt < dev->tx_len; cnt++) {
+        hal_spi_transfer(dev->tx_buf[cnt]);
+    }
+    rfm69_spi_end(dev);
+
+    rfm69_int_enable(dev);
+}
+
+
+/*****************************************************************************/
+/** RFM69 Start Sending Data
+ *
+ * Copies the frame and starts the transmission. The transmission is driven
+ * by rfm69_send_loop() which must be called from the main loop. The optional
+ * callback is called with the result after the transceiver is back in RX
+ * mode. Returns false if a transmission is already ongoing.
+ */
+bool rfm69_send_async(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t len,                                /**< data length */
-    uint8_t *data                               /**< data */
+    const uint8_t *data,                        /**< data */
+    void (*cb)(uint8_t result)                  /**< completion callback */
 )
 {
-    uint64_t ts64;                              /* timeout timestamp */
+    if (RFM69_SEND_STATE_IDLE != dev->tx_state) {
+        return false;
+    }
+
+    if (RFM69_FIFO_SIZE < len) {
+        len = RFM69_FIFO_SIZE;
+    }
+
+    dev->tx_spi_start = dev->spi_stats.transactions;
+
+    memcpy(dev->tx_buf, data, len);
+    dev->tx_len = len;
+    dev->tx_cb = cb;
+    dev->tx_result = RFM69_SEND_OK;
 
     /* restart RX to avoid RX deadlocks */
-    rfm69_reg_rw(RFM69_REG_PACKETCONFIG2,
+    rfm69_reg_rw(dev, RFM69_REG_PACKETCONFIG2,
                  RFM69_MSK_PACKETCONFIG2_RXRESTART,
                  RFM69_SHF_PACKETCONFIG2_RXRESTART,
                  RFM69_RXRESTART);
 
-    /* disable receiver and interrupts */
-    rfm69_opmode_set(RFM69_OPMODE_STANDBY);
-    rfm69_fifo_clear();
-    rfm69_int_disable();
+    /* disable receiver */
+    rfm69_opmode_request(dev, RFM69_OPMODE_STANDBY);
+    dev->tx_state = RFM69_SEND_STATE_STANDBY;
+    dev->tx_ts64 = rfm69_ts64 + RFM69_TIMEOUT_MS;
+
+    return true;
+}
 
-    /* transfer data */
-    digitalWrite(SS, LOW);
-    SPI.transfer(SPI_WRITE | RFM69_REG_FIFO);
 
-    for (; len; len--, data++) {
-        SPI.transfer(*data);
+/*****************************************************************************/
+/** RFM69 Transmission Ongoing
+ */
+bool rfm69_send_busy(
+    struct rfm69 *dev                           /**< instance */
+)
+{
+    return (RFM69_SEND_STATE_IDLE != dev->tx_state);
+}
+
+
+/*****************************************************************************/
+/** RFM69 Switch Mode From Send State Machine
+ */
+static void rfm69_send_next(
+    struct rfm69 *dev,                          /**< instance */
+    uint8_t mode,                               /**< next transceiver mode */
+    uint8_t state                               /**< next state */
+)
+{
+    rfm69_opmode_request(dev, mode);
+    dev->tx_state = state;
+    dev->tx_ts64 = rfm69_ts64 + RFM69_TIMEOUT_MS;
+}
+
+
+/*****************************************************************************/
+/** RFM69 Send State Machine
+ *
+ * Advances the transmission by at most one step without blocking.
+ */
+void rfm69_send_loop(
+    struct rfm69 *dev                           /**< instance */
+)
+{
+    void (*cb)(uint8_t result);                 /* completion callback */
+
+    if (RFM69_SEND_STATE_IDLE == dev->tx_state) {
+        return;
     }
-    digitalWrite(SS, HIGH);
 
-    /* enable interrupts and send frame */
-    rfm69_int_enable();
-    rfm69_opmode_set(RFM69_OPMODE_TX);
+    rfm69_timer_loop();
+
+    switch (dev->tx_state) {
+
+        case RFM69_SEND_STATE_STANDBY:
+        case RFM69_SEND_STATE_STANDBY_RX:
+        case RFM69_SEND_STATE_TX:
+        case RFM69_SEND_STATE_RX:
+            /* wait until mode is ready */
+            if (!rfm69_opmode_ready(dev)) {
+                if (rfm69_ts64 < dev->tx_ts64) {
+                    return;
+                }
+                dev->err_stats.opmode_timeouts++;
+                dev->tx_result = RFM69_SEND_TIMEOUT;
+            }
+            rfm69_opmode_finish(dev, dev->opmode);
+            break;
 
-    /* wait until data was sent
-     * (ISR flag is cleared at next mode set)
-     */
-    ts64 = rfm69_ts64 + RFM69_TIMEOUT_MS;
-    while (true != rfm69_flg_isr) {
+        case RFM69_SEND_STATE_SENT:
+            /* wait until data was sent
+             * (ISR flag is cleared at next mode set)
+             */
+            if (true != dev->flg_isr) {
+                if (rfm69_ts64 < dev->tx_ts64) {
+                    return;
+                }
+                dev->err_stats.send_timeouts++;
+                rfm69_fifo_clear(dev);
+                dev->tx_result = RFM69_SEND_TIMEOUT;
+            }
+            break;
+    }
 
-        rfm69_timer_loop();
-        if (rfm69_ts64 >= ts64) {
-            Serial.println("send: timeout");
-            rfm69_fifo_clear();
+    switch (dev->tx_state) {
+
+        case RFM69_SEND_STATE_STANDBY:
+            rfm69_fifo_clear(dev);
+
+            /* transfer data and send frame */
+            rfm69_send_fifo_write(dev);
+            rfm69_send_next(dev, RFM69_OPMODE_TX, RFM69_SEND_STATE_TX);
+            break;
+
+        case RFM69_SEND_STATE_TX:
+            dev->tx_state = RFM69_SEND_STATE_SENT;
+            break;
+
+        case RFM69_SEND_STATE_SENT:
+            /* switch back to receive mode */
+            rfm69_send_next(dev, RFM69_OPMODE_STANDBY, RFM69_SEND_STATE_STANDBY_RX);
+            break;
+
+        case RFM69_SEND_STATE_STANDBY_RX:
+            rfm69_send_next(dev, RFM69_OPMODE_RX, RFM69_SEND_STATE_RX);
+            break;
+
+        case RFM69_SEND_STATE_RX:
+            dev->tx_state = RFM69_SEND_STATE_IDLE;
+            dev->spi_stats.tx_transactions += dev->spi_stats.transactions - dev->tx_spi_start;
+            cb = dev->tx_cb;
+            dev->tx_cb = NULL;
+            if (cb) {
+                cb(dev->tx_result);
+            }
             break;
-        }
     }
+}
+
 
-    /* switch back to receive mode */
-    rfm69_opmode_set(RFM69_OPMODE_STANDBY);
-    rfm69_opmode_set(RFM69_OPMODE_RX);
+/*****************************************************************************/
+/** RFM69 Send Data
+ *
+ * Send given data and switch back to RX mode. Blocks until done.
+ */
+void rfm69_send(
+    struct rfm69 *dev,                          /**< instance */
+    uint8_t len,                                /**< data length */
+    uint8_t *data                               /**< data */
+)
+{
+    if (!rfm69_send_async(dev, len, data, NULL)) {
+        return;
+    }
+
+    while (rfm69_send_busy(dev)) {
+        rfm69_send_loop(dev);
+    }
 }
 
 
@@ -546,12 +1016,11 @@ void rfm69_send(
 /** RFM69 Packet Format
  */
 void rfm69_packet_format_var_len(
+    struct rfm69 *dev,                          /**< instance */
     bool var_len                                /**< variable length flag */
 )
 {
-    rfm69_var_len = var_len;
-
-    rfm69_reg_rw(RFM69_REG_PACKETCONFIG1,
+    rfm69_reg_rw(dev, RFM69_REG_PACKETCONFIG1,
                  RFM69_MSK_PACKETCONFIG1_PACKETFORMAT,
                  RFM69_SHF_PACKETCONFIG1_PACKETFORMAT,
                  (var_len) ? 1 : 0);
@@ -562,10 +1031,11 @@ void rfm69_packet_format_var_len(
 /** RFM69 TX Start Condition
  */
 void rfm69_tx_start_cond(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t val                                 /**< TX start condition */
 )
 {
-    rfm69_reg_rw(RFM69_REG_FIFOTHRESH,
+    rfm69_reg_rw(dev, RFM69_REG_FIFOTHRESH,
                  RFM69_MSK_FIFOTHRESH_TXSTARTCONDITION,
                  RFM69_SHF_FIFOTHRESH_TXSTARTCONDITION,
                  val);
@@ -579,8 +1049,8 @@ void rfm69_timer_loop(
     void
 )
 {
-    static unsigned long ts_last = millis();    /* last checked timestamp */
-    unsigned long ts = millis();                /* current timestamp */
+    static unsigned long ts_last = hal_millis(); /* last checked timestamp */
+    unsigned long ts = hal_millis();            /* current timestamp */
 
     if (ts == ts_last) {
         return;
@@ -600,15 +1070,14 @@ void rfm69_timer_loop(
 /** RFM69 Frequency Deviation in Hz
  */
 void rfm69_fdev_hz(
+    struct rfm69 *dev,                          /**< instance */
     uint16_t fdev_hz                            /**< value in Hz */
 )
 {
-    uint16_t fdev;                              /* frequency deviation reg val */
+    uint16_t fdev = rfm69_fdev_reg(fdev_hz);    /* frequency deviation reg val */
+    uint8_t vals[2] = { (uint8_t) (fdev >> 8), (uint8_t) fdev };
 
-    fdev = fdev_hz / RFM69_FREQ_FSTEP_HZ;
-
-    rfm69_reg_write_raw(RFM69_REG_FDEVMSB, (uint8_t) (fdev >> 8));
-    rfm69_reg_write_raw(RFM69_REG_FDEVLSB, (uint8_t) fdev);
+    rfm69_reg_write_burst(dev, RFM69_REG_FDEVMSB, vals, sizeof(vals));
 }
 
 
@@ -616,10 +1085,11 @@ void rfm69_fdev_hz(
 /** RFM69 Power Amplifier Selection
  */
 void rfm69_pa_sel(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t pa_sel                              /**< power amplifier mask */
 )
 {
-    rfm69_reg_rw(RFM69_REG_PALEVEL,
+    rfm69_reg_rw(dev, RFM69_REG_PALEVEL,
                  RFM69_MSK_PALEVEL_PA_ON,
                  RFM69_SHF_PALEVEL_PA_ON,
                  pa_sel);
@@ -633,16 +1103,17 @@ void rfm69_pa_sel(
  * RFM69HW = +5 .. 20 dBm => 0 = 5 dBm, 50 = 12 dBm, 100 = 20 dBM
  */
 void rfm69_output_power(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t val                                 /**< output power in percent */
 )
 {
-    if (rfm69_flg_is_hw) {
+    if (dev->flg_is_hw) {
         val = (val * (20 - 5)) / 100;
     } else {
         val = (val * (13 - (-18))) / 100;
     }
 
-    rfm69_reg_rw(RFM69_REG_PALEVEL,
+    rfm69_reg_rw(dev, RFM69_REG_PALEVEL,
                  RFM69_MSK_PALEVEL_OUTPUTPOWER,
                  RFM69_SHF_PALEVEL_OUTPUTPOWER,
                  val);
@@ -653,19 +1124,139 @@ void rfm69_output_power(
 /** RFM69 Packet Receive Check
  */
 bool rfm69_rx_avail(
-    void
+    struct rfm69 *dev                           /**< instance */
 )
 {
-    if (RFM69_OPMODE_RX != rfm69_opmode) {
+    if (RFM69_OPMODE_RX != dev->opmode) {
         return false;
     }
 
-    if (true == rfm69_flg_isr) {
-        rfm69_flg_isr = false;
+    if (true == dev->flg_isr) {
+        dev->flg_isr = false;
         return true;
     }
 
-    return rfm69_fifo_data_avail();
+    return rfm69_fifo_data_avail(dev);
+}
+
+
+/*****************************************************************************/
+/** RFM69 Poll Receiver
+ *
+ * Moves a received frame from the FIFO into the RX queue. The ISR only
+ * records the PayloadReady timestamp as SPI access from the ISR must be
+ * avoided, so this should be called as often as possible from the main
+ * context. Returns true if a frame was queued.
+ */
+bool rfm69_rx_poll(
+    struct rfm69 *dev                           /**< instance */
+)
+{
+    struct rfm69_rx_frame *frame;               /* queue slot */
+    uint8_t head = dev->rx_head;               /* write index */
+    unsigned long ts;                           /* timestamp */
+
+    if ((RFM69_OPMODE_RX != dev->opmode) || rfm69_send_busy(dev)) {
+        return false;
+    }
+
+    /* the ISR flag only provides the timestamp, PayloadReady is always
+     * checked so a stale flag can't produce an empty frame
+     */
+    ts = (dev->flg_isr) ? dev->isr_ts : hal_millis();
+    dev->flg_isr = false;
+
+    if (!rfm69_fifo_data_avail(dev)) {
+        return false;
+    }
+
+    /* drop frame on full queue but still empty the FIFO */
+    if (((uint8_t) (head - dev->rx_tail)) >= RFM69_RX_QUEUE_LEN) {
+        dev->rx_stats.overflow++;
+        rfm69_fifo_clear(dev);
+        return false;
+    }
+
+    frame = &dev->rx_queue[head & (RFM69_RX_QUEUE_LEN - 1)];
+    frame->ts = ts;
+    frame->len = rfm69_fifo_read_burst(dev, frame->data,
+                                       (dev->shadow[RFM69_REG_PAYLOADLENGTH] < RFM69_RX_FRAME_MAX)
+                                       ? dev->shadow[RFM69_REG_PAYLOADLENGTH] : RFM69_RX_FRAME_MAX);
+    frame->rssi = rfm69_reg_read_raw(dev, RFM69_REG_RSSIVALUE);
+
+    /* publish frame */
+    dev->rx_head = head + 1;
+    dev->rx_stats.frames++;
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/** RFM69 Oldest Received Frame
+ *
+ * Returns NULL if the RX queue is empty.
+ */
+struct rfm69_rx_frame * rfm69_rx_peek(
+    struct rfm69 *dev                           /**< instance */
+)
+{
+    uint8_t tail = dev->rx_tail;               /* read index */
+
+    if (tail == dev->rx_head) {
+        return NULL;
+    }
+
+    return &dev->rx_queue[tail & (RFM69_RX_QUEUE_LEN - 1)];
+}
+
+
+/*****************************************************************************/
+/** RFM69 Release Oldest Received Frame
+ */
+void rfm69_rx_pop(
+    struct rfm69 *dev                           /**< instance */
+)
+{
+    if (dev->rx_tail != dev->rx_head) {
+        dev->rx_tail = dev->rx_tail + 1;
+    }
+}
+
+
+/*****************************************************************************/
+/** RFM69 RX Statistics
+ */
+const struct rfm69_rx_stats * rfm69_rx_stats_get(
+    struct rfm69 *dev                           /**< instance */
+)
+{
+    return &dev->rx_stats;
+}
+
+
+/*****************************************************************************/
+/** RFM69 SPI Statistics
+ */
+const struct rfm69_spi_stats * rfm69_spi_stats_get(
+    struct rfm69 *dev                           /**< instance */
+)
+{
+    return &dev->spi_stats;
+}
+
+
+/*****************************************************************************/
+/** RFM69 Timeout Statistics
+ *
+ * The driver doesn't print, the caller reports new timeouts in its own
+ * output format.
+ */
+const struct rfm69_err_stats * rfm69_err_stats_get(
+    struct rfm69 *dev                           /**< instance */
+)
+{
+    return &dev->err_stats;
 }
 
 
@@ -673,10 +1264,11 @@ bool rfm69_rx_avail(
 /** RFM69 Over Current Protection
  */
 void rfm69_ocp(
+    struct rfm69 *dev,                          /**< instance */
     bool on                                     /**< OCP on flag */
 )
 {
-    rfm69_reg_rw(RFM69_REG_OCP,
+    rfm69_reg_rw(dev, RFM69_REG_OCP,
                  RFM69_MSK_OCP_OCP_ON,
                  RFM69_SHF_OCP_OCP_ON,
                  !!on);
@@ -687,12 +1279,13 @@ void rfm69_ocp(
 /** RFM69 High Power Power Amplifier
  */
 void rfm69_high_power_pa(
+    struct rfm69 *dev,                          /**< instance */
     bool on                                     /**< high power PA */
 )
 {
-    rfm69_reg_write_raw(RFM69_REG_TESTPA1,
+    rfm69_reg_write_raw(dev, RFM69_REG_TESTPA1,
                         (on) ? RFM69_PA20DBM1_20DBM_MODE : RFM69_PA20DBM1_NORMAL);
 
-    rfm69_reg_write_raw(RFM69_REG_TESTPA2,
+    rfm69_reg_write_raw(dev, RFM69_REG_TESTPA2,
                         (on) ? RFM69_PA20DBM2_20DBM_MODE : RFM69_PA20DBM2_NORMAL);
 }
@@ -29,6 +29,29 @@
 
 #define RFM69_TIMEOUT_MS                            1000
 
+#define RFM69_FIFO_SIZE                             66
+
+#define RFM69_SEND_OK                               0
+#define RFM69_SEND_TIMEOUT                          1
+
+#define RFM69_SEND_STATE_IDLE                       0
+#define RFM69_SEND_STATE_STANDBY                    1
+#define RFM69_SEND_STATE_TX                         2
+#define RFM69_SEND_STATE_SENT                       3
+#define RFM69_SEND_STATE_STANDBY_RX                 4
+#define RFM69_SEND_STATE_RX                         5
+
+#ifndef RFM69_RX_QUEUE_LEN
+#  define RFM69_RX_QUEUE_LEN                        4       /**< must be a power of 2 */
+#endif
+
+#ifndef RFM69_RX_FRAME_MAX
+#  define RFM69_RX_FRAME_MAX                        16
+#endif
+
+#define RFM69_SHADOW_SIZE                           0x40    /**< 0x01..0x3d, TestPa1/2 */
+#define RFM69_SHADOW_NONE                           0xff
+
 
 /*****************************************************************************/
 /* SPI */
@@ -86,6 +109,12 @@
 #define RFM69_REG_FRFLSB                            0x09
 
 
+/*****************************************************************************/
+/* 0x0a RegOsc1 */
+/*****************************************************************************/
+#define RFM69_REG_OSC1                              0x0a
+
+
 /*****************************************************************************/
 /* 0x11 RegPaLevel */
 /*****************************************************************************/
@@ -121,6 +150,18 @@
 #define RFM69_SHF_RXBW_RXBWEXP                      0
 
 
+/*****************************************************************************/
+/* 0x1e RegAfcFei */
+/*****************************************************************************/
+#define RFM69_REG_AFCFEI                            0x1e
+
+
+/*****************************************************************************/
+/* 0x24 RegRssiValue */
+/*****************************************************************************/
+#define RFM69_REG_RSSIVALUE                         0x24
+
+
 /*****************************************************************************/
 /* 0x25 RegDioMapping1 */
 /* 0x26 RegDioMapping2 */
@@ -151,12 +192,18 @@
 #define RFM69_MSK_IRQFLAGS1_TXREADY                 0x01
 #define RFM69_SHF_IRQFLAGS1_TXREADY                 5
 
+#define RFM69_MSK_IRQFLAGS1_AUTOMODE                0x01
+#define RFM69_SHF_IRQFLAGS1_AUTOMODE                1
+
 
 /*****************************************************************************/
 /* 0x28 RegIrqFlags2 */
 /*****************************************************************************/
 #define RFM69_REG_IRQFLAGS2                         0x28
 
+#define RFM69_MSK_IRQFLAGS2_FIFONOTEMPTY            0x01
+#define RFM69_SHF_IRQFLAGS2_FIFONOTEMPTY            6
+
 #define RFM69_MSK_IRQFLAGS2_FIFOOVERRUN             0x01
 #define RFM69_SHF_IRQFLAGS2_FIFOOVERRUN             4
 
@@ -173,6 +220,14 @@
 #define RFM69_REG_RSSITHRESH                        0x29
 
 
+/*****************************************************************************/
+/* 0x2C RegPreambleMsb */
+/* 0x2D RegPreambleLsb */
+/*****************************************************************************/
+#define RFM69_REG_PREAMBLEMSB                       0x2c
+#define RFM69_REG_PREAMBLELSB                       0x2d
+
+
 /*****************************************************************************/
 /* 0x2E RegSyncConfig */
 /* 0x2F RegSyncValue1 */
@@ -208,6 +263,17 @@
 #define RFM69_REG_PAYLOADLENGTH                     0x38
 
 
+/*****************************************************************************/
+/* 0x3b RegAutoModes */
+/*****************************************************************************/
+#define RFM69_REG_AUTOMODES                         0x3b
+
+#define RFM69_AUTOMODES_OFF                         0x00
+#define RFM69_AUTOMODES_ENTER_FIFONOTEMPTY          (0x01 << 5)
+#define RFM69_AUTOMODES_EXIT_PACKETSENT             (0x06 << 2)
+#define RFM69_AUTOMODES_INTERMEDIATE_TX             0x03
+
+
 /*****************************************************************************/
 /* 0x3c RegFifoThresh */
 /*****************************************************************************/
@@ -243,30 +309,200 @@
 #define RFM69_PA20DBM2_20DBM_MODE                   0x7c
 
 
+/*****************************************************************************/
+/* Structures */
+/*****************************************************************************/
+struct rfm69_rx_frame {
+    unsigned long ts;                           /**< PayloadReady timestamp (ms) */
+    uint8_t len;                                /**< payload length */
+    uint8_t rssi;                               /**< RegRssiValue (-RSSI * 2) */
+    uint8_t data[RFM69_RX_FRAME_MAX];           /**< payload */
+};
+
+struct rfm69_rx_stats {
+    uint16_t frames;                            /**< queued frames */
+    uint16_t overflow;                          /**< frames dropped on full queue */
+};
+
+struct rfm69_err_stats {
+    uint16_t opmode_timeouts;                   /**< ModeReady waits that timed out */
+    uint16_t send_timeouts;                     /**< sends without PacketSent */
+};
+
+struct rfm69_spi_stats {
+    uint32_t transactions;                      /**< SPI transactions */
+    uint32_t tx_transactions;                   /**< transactions of completed sends */
+    uint32_t skipped;                           /**< writes and reads served by shadow */
+};
+
+struct rfm69_reg_field {
+    uint8_t addr;                               /**< register address */
+    uint8_t mask;                               /**< field mask (shifted) */
+    uint8_t val;                                /**< field value (shifted) */
+};
+
+struct rfm69 {
+    uint8_t pin_spi_ss;                         /**< SPI slave select pin */
+    uint8_t pin_irq;                            /**< DIO0 interrupt pin */
+    void (*irq_handler)(void);                  /**< DIO0 interrupt handler */
+    bool flg_is_hw;                             /**< RFM69HW flag */
+    uint8_t opmode;                             /**< operation mode */
+    volatile bool flg_isr;                      /**< ISR flag */
+    volatile unsigned long isr_ts;              /**< ISR timestamp */
+    uint8_t dio_mapping_rx_dio;                 /**< RX DIO selector */
+    uint8_t dio_mapping_rx_val;                 /**< RX DIO value */
+    uint8_t dio_mapping_tx_dio;                 /**< TX DIO selector */
+    uint8_t dio_mapping_tx_val;                 /**< TX DIO value */
+    struct rfm69_rx_frame rx_queue[RFM69_RX_QUEUE_LEN]; /**< RX queue */
+    volatile uint8_t rx_head;                   /**< RX queue write index */
+    volatile uint8_t rx_tail;                   /**< RX queue read index */
+    struct rfm69_rx_stats rx_stats;             /**< RX statistics */
+    uint8_t tx_state;                           /**< send state */
+    uint8_t tx_buf[RFM69_FIFO_SIZE];            /**< send buffer */
+    uint8_t tx_len;                             /**< send length */
+    uint8_t tx_result;                          /**< send result */
+    uint64_t tx_ts64;                           /**< send step timeout */
+    void (*tx_cb)(uint8_t result);              /**< send callback */
+    uint32_t tx_spi_start;                      /**< SPI transactions at send start */
+    uint8_t shadow[RFM69_SHADOW_SIZE];          /**< register shadow */
+    struct rfm69_spi_stats spi_stats;           /**< SPI statistics */
+    struct rfm69_err_stats err_stats;           /**< timeouts, reported by the caller */
+};
+
+
+/*****************************************************************************/
+/* Instance Definition
+ *
+ * Defines a driver instance and the DIO0 interrupt handler bound to it. The
+ * handler is passed to rfm69_init().
+ */
+/*****************************************************************************/
+#define RFM69_INSTANCE(name) \
+    static struct rfm69 name; \
+    static void name##_isr(void) { rfm69_isr(&name); }
+
+
+/*****************************************************************************/
+/* Register Value Calculation
+ *
+ * Integer versions of the datasheet formulas, usable at compile time and at
+ * runtime. The carrier calculation is valid up to 2097 MHz.
+ */
+/*****************************************************************************/
+static constexpr uint32_t rfm69_frf_reg(
+    uint32_t freq_khz                           /**< carrier frequency in kHz */
+)
+{
+    /* Fstep = 32 MHz / 2^19 => kHz * 2^19 / 32000 = kHz * 2048 / 125 */
+    return (freq_khz * 2048) / 125;
+}
+
+static constexpr uint16_t rfm69_bitrate_reg(
+    uint16_t bitrate_bs                         /**< bitrate in b/s */
+)
+{
+    return 32000000UL / bitrate_bs;
+}
+
+static constexpr uint16_t rfm69_fdev_reg(
+    uint16_t fdev_hz                            /**< frequency deviation in Hz */
+)
+{
+    return ((uint32_t) fdev_hz * 2048) / 125000;
+}
+
+
+/*****************************************************************************/
+/* Configuration Table Entries
+ *
+ * A configuration is an array of struct rfm69_reg_field in PROGMEM that is
+ * applied by rfm69_config(). All values are folded by the compiler.
+ */
+/*****************************************************************************/
+#define RFM69_CFG_REG(addr, val) \
+    { (addr), 0xff, (uint8_t) (val) }
+
+#define RFM69_CFG_FIELD(addr, msk, shf, val) \
+    { (addr), (uint8_t) ((msk) << (shf)), (uint8_t) (((val) & (msk)) << (shf)) }
+
+#define RFM69_CFG_FREQ_KHZ(freq_khz) \
+    RFM69_CFG_REG(RFM69_REG_FRFMSB, rfm69_frf_reg(freq_khz) >> 16), \
+    RFM69_CFG_REG(RFM69_REG_FRFMID, rfm69_frf_reg(freq_khz) >> 8), \
+    RFM69_CFG_REG(RFM69_REG_FRFLSB, rfm69_frf_reg(freq_khz))
+
+#define RFM69_CFG_BITRATE_BS(bitrate_bs) \
+    RFM69_CFG_REG(RFM69_REG_BITRATEMSB, rfm69_bitrate_reg(bitrate_bs) >> 8), \
+    RFM69_CFG_REG(RFM69_REG_BITRATELSB, rfm69_bitrate_reg(bitrate_bs))
+
+#define RFM69_CFG_FDEV_HZ(fdev_hz) \
+    RFM69_CFG_REG(RFM69_REG_FDEVMSB, rfm69_fdev_reg(fdev_hz) >> 8), \
+    RFM69_CFG_REG(RFM69_REG_FDEVLSB, rfm69_fdev_reg(fdev_hz))
+
+#define RFM69_CFG_CLKOUT(clkout) \
+    RFM69_CFG_FIELD(RFM69_REG_DIOMAPPING2, RFM69_MSK_DIOMAPPING2_CLKOUT, RFM69_SHF_DIOMAPPING2_CLKOUT, clkout)
+
+#define RFM69_CFG_RX_BW_EXP(exp) \
+    RFM69_CFG_FIELD(RFM69_REG_RXBW, RFM69_MSK_RXBW_RXBWEXP, RFM69_SHF_RXBW_RXBWEXP, exp)
+
+#define RFM69_CFG_RSSI_THRESHOLD(threshold) \
+    RFM69_CFG_REG(RFM69_REG_RSSITHRESH, threshold)
+
+#define RFM69_CFG_SYNC_ON(on) \
+    RFM69_CFG_FIELD(RFM69_REG_SYNCCONFIG, RFM69_MSK_SYNCCONFIG_SYNCON, RFM69_SHF_SYNCCONFIG_SYNCON, (on) ? 1 : 0)
+
+#define RFM69_CFG_SYNC_SIZE(size) \
+    RFM69_CFG_FIELD(RFM69_REG_SYNCCONFIG, RFM69_MSK_SYNCCONFIG_SYNCSIZE, RFM69_SHF_SYNCCONFIG_SYNCSIZE, (size) - 1)
+
+#define RFM69_CFG_SYNC_VALUE(idx, val) \
+    RFM69_CFG_REG(RFM69_REG_SYNCVALUE1 + (idx), val)
+
+#define RFM69_CFG_PACKET_FORMAT_VAR_LEN(var_len) \
+    RFM69_CFG_FIELD(RFM69_REG_PACKETCONFIG1, RFM69_MSK_PACKETCONFIG1_PACKETFORMAT, RFM69_SHF_PACKETCONFIG1_PACKETFORMAT, (var_len) ? 1 : 0)
+
+#define RFM69_CFG_CRC_ON(on) \
+    RFM69_CFG_FIELD(RFM69_REG_PACKETCONFIG1, RFM69_MSK_PACKETCONFIG1_CRCON, RFM69_SHF_PACKETCONFIG1_CRCON, (on) ? 1 : 0)
+
+#define RFM69_CFG_CRC_AUTO_CLEAR_OFF(off) \
+    RFM69_CFG_FIELD(RFM69_REG_PACKETCONFIG1, RFM69_MSK_PACKETCONFIG1_CRCAUTOCLEAROFF, RFM69_SHF_PACKETCONFIG1_CRCAUTOCLEAROFF, (off) ? 1 : 0)
+
+#define RFM69_CFG_PAYLOAD_LENGTH(len) \
+    RFM69_CFG_REG(RFM69_REG_PAYLOADLENGTH, len)
+
+#define RFM69_CFG_TX_START_COND(cond) \
+    RFM69_CFG_FIELD(RFM69_REG_FIFOTHRESH, RFM69_MSK_FIFOTHRESH_TXSTARTCONDITION, RFM69_SHF_FIFOTHRESH_TXSTARTCONDITION, cond)
+
+
 /*****************************************************************************/
 /* Prototypes */
 /*****************************************************************************/
 void rfm69_init(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t pin_spi_ss,                         /**< SPI slave select pin */
+    uint8_t pin_irq,                            /**< DIO0 interrupt pin */
+    void (*irq_handler)(void),                  /**< DIO0 interrupt handler */
     uint8_t flg_is_rfm69hw                      /**< output power flag */
 );
 
 uint8_t rfm69_reg_read_raw(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t addr                                /**< register address */
 );
 
 void rfm69_reg_write_raw(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t addr,                               /**< register address */
     uint8_t val                                 /**< value */
 );
 
 uint8_t rfm69_reg_read(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t addr,                               /**< register address */
     uint8_t mask,                               /**< value mask */
     uint8_t shift                               /**< value shift */
 );
 
 void rfm69_reg_rw(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t addr,                               /**< register address */
     uint8_t mask,                               /**< value mask */
     uint8_t shift,                              /**< value shift */
@@ -274,95 +510,139 @@ void rfm69_reg_rw(
 );
 
 uint8_t rfm69_opmode_get(
-    void
+    struct rfm69 *dev                           /**< instance */
 );
 
 void rfm69_opmode_set(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t mode                                /**< transceiver mode */
 );
 
+void rfm69_config(
+    struct rfm69 *dev,                          /**< instance */
+    const struct rfm69_reg_field *fields,       /**< field table in PROGMEM */
+    uint8_t cnt                                 /**< field count */
+);
+
 void rfm69_freq_carrier_khz(
+    struct rfm69 *dev,                          /**< instance */
     uint32_t freq_khz                           /**< carrier frequency in kHz */
 );
 
 void rfm69_bitrate_bs(
+    struct rfm69 *dev,                          /**< instance */
     uint16_t bitrate_bs                         /**< bitrate in b/s */
 );
 
 void rfm69_dio_mapping_rx(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t dio,                                /**< DIO number */
     uint8_t val                                 /**< map value */
 );
 
 void rfm69_dio_mapping_tx(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t dio,                                /**< DIO number */
     uint8_t val                                 /**< map value */
 );
 
 void rfm69_dio_mapping(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t dio,                                /**< DIO number */
     uint8_t val                                 /**< map value */
 );
 
 void rfm69_clkout(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t clkout                              /**< CLKOUT config */
 );
 
 void rfm69_crc_on(
+    struct rfm69 *dev,                          /**< instance */
     bool on                                     /**< CRC calculation on flag */
 );
 
 void rfm69_crc_auto_clear_off(
+    struct rfm69 *dev,                          /**< instance */
     bool off                                    /**< CRC auto clear off flag */
 );
 
 void rfm69_payload_length(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t len                                 /**< payload length */
 );
 
 void rfm69_sync_on(
+    struct rfm69 *dev,                          /**< instance */
     bool on                                     /**< sync on flag */
 );
 
 void rfm69_sync_word(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t size,                               /**< sync word size */
     uint8_t *values                             /**< sync values */
 );
 
 void rfm69_rx_bw_exp(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t exp                                 /**< exponent */
 );
 
 void rfm69_rssi_threshold(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t threshold                           /**< threshold */
 );
 
 void rfm69_fifo_clear(
-    void
+    struct rfm69 *dev                           /**< instance */
 );
 
 void rfm69_isr(
-  void
+    struct rfm69 *dev                           /**< instance */
 );
 
 bool rfm69_fifo_data_avail(
-    void
+    struct rfm69 *dev                           /**< instance */
 );
 
 uint8_t rfm69_fifo_data(
-    void
+    struct rfm69 *dev                           /**< instance */
+);
+
+uint8_t rfm69_fifo_read_burst(
+    struct rfm69 *dev,                          /**< instance */
+    uint8_t *buf,                               /**< destination buffer */
+    uint8_t len                                 /**< bytes to read */
 );
 
 void rfm69_send(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t len,                                /**< data length */
     uint8_t *data                               /**< data */
 );
 
+bool rfm69_send_async(
+    struct rfm69 *dev,                          /**< instance */
+    uint8_t len,                                /**< data length */
+    const uint8_t *data,                        /**< data */
+    void (*cb)(uint8_t result)                  /**< completion callback */
+);
+
+bool rfm69_send_busy(
+    struct rfm69 *dev                           /**< instance */
+);
+
+void rfm69_send_loop(
+    struct rfm69 *dev                           /**< instance */
+);
+
 void rfm69_packet_format_var_len(
+    struct rfm69 *dev,                          /**< instance */
     bool var_len                                /**< variable length flag */
 );
 
 void rfm69_tx_start_cond(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t val                                 /**< TX start condition */
 );
 
@@ -371,34 +651,63 @@ void rfm69_timer_loop(
 );
 
 void rfm69_int_enable(
-    void
+    struct rfm69 *dev                           /**< instance */
 );
 
 void rfm69_int_disable(
-    void
+    struct rfm69 *dev                           /**< instance */
 );
 
 void rfm69_fdev_hz(
+    struct rfm69 *dev,                          /**< instance */
     uint16_t fdev_hz                            /**< value in Hz */
 );
 
 void rfm69_pa_sel(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t pa_sel                              /**< power amplifier mask */
 );
 
 void rfm69_output_power(
+    struct rfm69 *dev,                          /**< instance */
     uint8_t val                                 /**< output power in percent */
 );
 
 bool rfm69_rx_avail(
-    void
+    struct rfm69 *dev                           /**< instance */
+);
+
+bool rfm69_rx_poll(
+    struct rfm69 *dev                           /**< instance */
+);
+
+struct rfm69_rx_frame * rfm69_rx_peek(
+    struct rfm69 *dev                           /**< instance */
+);
+
+void rfm69_rx_pop(
+    struct rfm69 *dev                           /**< instance */
+);
+
+const struct rfm69_rx_stats * rfm69_rx_stats_get(
+    struct rfm69 *dev                           /**< instance */
+);
+
+const struct rfm69_spi_stats * rfm69_spi_stats_get(
+    struct rfm69 *dev                           /**< instance */
+);
+
+const struct rfm69_err_stats * rfm69_err_stats_get(
+    struct rfm69 *dev                           /**< instance */
 );
 
 void rfm69_ocp(
+    struct rfm69 *dev,                          /**< instance */
     bool on                                     /**< OCP on flag */
 );
 
 void rfm69_high_power_pa(
+    struct rfm69 *dev,                          /**< instance */
     bool on                                     /**< high power PA */
 );
 
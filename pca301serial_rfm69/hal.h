@@ -0,0 +1,170 @@
+/**
+ * @brief Hardware Abstraction Layer
+ *
+ * Thin layer between the firmware and the board. The radio driver and the
+ * PCA301 protocol code only use these functions to access SPI, GPIOs, the
+ * clock, the RFM69 interrupt line, the serial port and the EEPROM.
+ *
+ * On Arduino the functions are implemented in hal_arduino.cpp. For other
+ * targets (eg. the Linux host build in ../host) the implementation is provided
+ * by the target and a compatibility header named hal_host_compat.h must be in
+ * the include path.
+ *
+ * Copyright (c) 2017, Sven Bachmann <dev@mcbachmann.de>
+ *
+ * Licensed under the MIT license, see LICENSE for details.
+ */
+#ifndef HAL_H
+#define HAL_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#  include "Arduino.h"
+#elif defined(ARDUINO)
+#  include "WProgram.h"
+#else
+#  include "hal_host_compat.h"
+#endif
+
+
+/*****************************************************************************/
+/* Defines */
+/*****************************************************************************/
+#define HAL_IRQ_RISING                              1
+#define HAL_EEPROM_SIZE                             (E2END + 1)
+
+
+/*****************************************************************************/
+/* SPI */
+/*****************************************************************************/
+void hal_spi_init(
+    uint8_t pin_ss                              /**< slave select pin */
+);
+
+void hal_spi_select(
+    uint8_t pin_ss                              /**< slave select pin */
+);
+
+void hal_spi_deselect(
+    uint8_t pin_ss                              /**< slave select pin */
+);
+
+uint8_t hal_spi_transfer(
+    uint8_t val                                 /**< value to send */
+);
+
+
+/*****************************************************************************/
+/* GPIO */
+/*****************************************************************************/
+void hal_gpio_output(
+    uint8_t pin                                 /**< pin number */
+);
+
+void hal_gpio_input(
+    uint8_t pin                                 /**< pin number */
+);
+
+void hal_gpio_write(
+    uint8_t pin,                                /**< pin number */
+    bool high                                   /**< output level */
+);
+
+
+/*****************************************************************************/
+/* Clock */
+/*****************************************************************************/
+unsigned long hal_millis(
+    void
+);
+
+void hal_delay_ms(
+    unsigned long ms                            /**< delay in milliseconds */
+);
+
+long hal_random(
+    long min,                                   /**< lower bound */
+    long max                                    /**< upper bound (exclusive) */
+);
+
+
+/*****************************************************************************/
+/* IRQ */
+/*****************************************************************************/
+void hal_irq_attach(
+    uint8_t pin,                                /**< interrupt pin */
+    void (*handler)(void),                      /**< interrupt handler */
+    uint8_t mode                                /**< trigger mode */
+);
+
+void hal_irq_detach(
+    uint8_t pin                                 /**< interrupt pin */
+);
+
+
+/*****************************************************************************/
+/* Serial */
+/*****************************************************************************/
+void hal_serial_init(
+    unsigned long bps                           /**< speed in bits/s */
+);
+
+bool hal_serial_ready(
+    void
+);
+
+int hal_serial_available(
+    void
+);
+
+int hal_serial_read(
+    void
+);
+
+int hal_serial_tx_free(
+    void
+);
+
+void hal_serial_print(
+    const char *str                             /**< string */
+);
+
+void hal_serial_print_char(
+    char c                                      /**< character */
+);
+
+void hal_serial_print_dec(
+    uint32_t val                                /**< value */
+);
+
+void hal_serial_println(
+    void
+);
+
+
+/*****************************************************************************/
+/* EEPROM */
+/*****************************************************************************/
+void hal_eeprom_read_block(
+    void *dst,                                  /**< destination buffer */
+    uint16_t addr,                              /**< EEPROM address */
+    uint16_t len                                /**< length */
+);
+
+void hal_eeprom_write_block(
+    const void *src,                            /**< source buffer */
+    uint16_t addr,                              /**< EEPROM address */
+    uint16_t len                                /**< length */
+);
+
+bool hal_eeprom_write_async(
+    const void *src,                            /**< source buffer, kept until done */
+    uint16_t addr,                              /**< EEPROM address */
+    uint16_t len                                /**< length */
+);
+
+bool hal_eeprom_busy(
+    void
+);
+
+
+#endif /* HAL_H */
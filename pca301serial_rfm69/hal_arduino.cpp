@@ -0,0 +1,365 @@
+/**
+ * @brief Hardware Abstraction Layer - Arduino Implementation
+ *
+ * Copyright (c) 2017, Sven Bachmann <dev@mcbachmann.de>
+ *
+ * Licensed under the MIT license, see LICENSE for details.
+ */
+#ifdef ARDUINO
+
+#include <SPI.h>
+#include <avr/eeprom.h>
+#include <avr/interrupt.h>
+#include "hal.h"
+
+
+/*****************************************************************************/
+/* Local variables */
+/*****************************************************************************/
+static const uint8_t *hal_eeprom_src;           /**< background write source */
+static uint16_t hal_eeprom_addr;                /**< background write address */
+static volatile uint16_t hal_eeprom_len;        /**< bytes left to write */
+
+
+/*****************************************************************************/
+/** SPI Initialization
+ */
+void hal_spi_init(
+    uint8_t pin_ss                              /**< slave select pin */
+)
+{
+    pinMode(pin_ss, OUTPUT);
+    digitalWrite(pin_ss, HIGH);
+    SPI.begin();
+    SPI.setBitOrder(MSBFIRST);
+}
+
+
+/*****************************************************************************/
+/** SPI Select Slave
+ */
+void hal_spi_select(
+    uint8_t pin_ss                              /**< slave select pin */
+)
+{
+    digitalWrite(pin_ss, LOW);
+}
+
+
+/*****************************************************************************/
+/** SPI Deselect Slave
+ */
+void hal_spi_deselect(
+    uint8_t pin_ss                              /**< slave select pin */
+)
+{
+    digitalWrite(pin_ss, HIGH);
+}
+
+
+/*****************************************************************************/
+/** SPI Transfer Byte
+ */
+uint8_t hal_spi_transfer(
+    uint8_t val                                 /**< value to send */
+)
+{
+    return SPI.transfer(val);
+}
+
+
+/*****************************************************************************/
+/** GPIO Configure Output
+ */
+void hal_gpio_output(
+    uint8_t pin                                 /**< pin number */
+)
+{
+    pinMode(pin, OUTPUT);
+}
+
+
+/*****************************************************************************/
+/** GPIO Configure Input
+ */
+void hal_gpio_input(
+    uint8_t pin                                 /**< pin number */
+)
+{
+    pinMode(pin, INPUT);
+}
+
+
+/*****************************************************************************/
+/** GPIO Write
+ */
+void hal_gpio_write(
+    uint8_t pin,                                /**< pin number */
+    bool high                                   /**< output level */
+)
+{
+    digitalWrite(pin, (high) ? HIGH : LOW);
+}
+
+
+/*****************************************************************************/
+/** Milliseconds Since Start
+ */
+unsigned long hal_millis(
+    void
+)
+{
+    return millis();
+}
+
+
+/*****************************************************************************/
+/** Delay in Milliseconds
+ */
+void hal_delay_ms(
+    unsigned long ms                            /**< delay in milliseconds */
+)
+{
+    delay(ms);
+}
+
+
+/*****************************************************************************/
+/** Random Number
+ */
+long hal_random(
+    long min,                                   /**< lower bound */
+    long max                                    /**< upper bound (exclusive) */
+)
+{
+    return random(min, max);
+}
+
+
+/*****************************************************************************/
+/** Attach Interrupt Handler
+ */
+void hal_irq_attach(
+    uint8_t pin,                                /**< interrupt pin */
+    void (*handler)(void),                      /**< interrupt handler */
+    uint8_t mode                                /**< trigger mode */
+)
+{
+    (void) mode;
+    attachInterrupt(digitalPinToInterrupt(pin), handler, RISING);
+}
+
+
+/*****************************************************************************/
+/** Detach Interrupt Handler
+ */
+void hal_irq_detach(
+    uint8_t pin                                 /**< interrupt pin */
+)
+{
+    detachInterrupt(digitalPinToInterrupt(pin));
+}
+
+
+/*****************************************************************************/
+/** Serial Initialization
+ */
+void hal_serial_init(
+    unsigned long bps                           /**< speed in bits/s */
+)
+{
+    Serial.begin(bps);
+}
+
+
+/*****************************************************************************/
+/** Serial Ready
+ */
+bool hal_serial_ready(
+    void
+)
+{
+    return (Serial) ? true : false;
+}
+
+
+/*****************************************************************************/
+/** Serial Bytes Available
+ */
+int hal_serial_available(
+    void
+)
+{
+    return Serial.available();
+}
+
+
+/*****************************************************************************/
+/** Serial Read Byte
+ */
+int hal_serial_read(
+    void
+)
+{
+    return Serial.read();
+}
+
+
+/*****************************************************************************/
+/** Serial TX Buffer Space
+ *
+ * Number of bytes that can be printed without blocking.
+ */
+int hal_serial_tx_free(
+    void
+)
+{
+    return Serial.availableForWrite();
+}
+
+
+/*****************************************************************************/
+/** Serial Print String
+ */
+void hal_serial_print(
+    const char *str                             /**< string */
+)
+{
+    Serial.print(str);
+}
+
+
+/*****************************************************************************/
+/** Serial Print Character
+ */
+void hal_serial_print_char(
+    char c                                      /**< character */
+)
+{
+    Serial.print(c);
+}
+
+
+/*****************************************************************************/
+/** Serial Print Decimal Value
+ */
+void hal_serial_print_dec(
+    uint32_t val                                /**< value */
+)
+{
+    Serial.print(val);
+}
+
+
+/*****************************************************************************/
+/** Serial Print Newline
+ */
+void hal_serial_println(
+    void
+)
+{
+    Serial.println();
+}
+
+
+/*****************************************************************************/
+/** EEPROM Read Block
+ *
+ * Waits for a background write, its interrupt would change EEAR meanwhile.
+ */
+void hal_eeprom_read_block(
+    void *dst,                                  /**< destination buffer */
+    uint16_t addr,                              /**< EEPROM address */
+    uint16_t len                                /**< length */
+)
+{
+    while (hal_eeprom_busy());
+    eeprom_read_block(dst, (const void *) addr, len);
+}
+
+
+/*****************************************************************************/
+/** EEPROM Write Block
+ */
+void hal_eeprom_write_block(
+    const void *src,                            /**< source buffer */
+    uint16_t addr,                              /**< EEPROM address */
+    uint16_t len                                /**< length */
+)
+{
+    while (hal_eeprom_busy());
+    eeprom_write_block(src, (void *) addr, len);
+}
+
+
+/*****************************************************************************/
+/** EEPROM Write Block In Background
+ *
+ * The EEPROM ready interrupt writes one changed byte after the other, the
+ * source buffer must stay untouched until hal_eeprom_busy() returns false.
+ */
+bool hal_eeprom_write_async(
+    const void *src,                            /**< source buffer, kept until done */
+    uint16_t addr,                              /**< EEPROM address */
+    uint16_t len                                /**< length */
+)
+{
+    if (hal_eeprom_busy()) {
+        return false;
+    }
+
+    hal_eeprom_src = (const uint8_t *) src;
+    hal_eeprom_addr = addr;
+    hal_eeprom_len = len;
+    EECR |= _BV(EERIE);
+
+    return true;
+}
+
+
+/*****************************************************************************/
+/** EEPROM Background Write Pending
+ */
+bool hal_eeprom_busy(
+    void
+)
+{
+    uint8_t sreg = SREG;
+    bool busy;
+
+    /* the 16 bit counter changes in the ISR */
+    cli();
+    busy = hal_eeprom_len || (EECR & _BV(EEPE));
+    SREG = sreg;
+
+    return busy;
+}
+
+
+/*****************************************************************************/
+/** EEPROM Ready Interrupt
+ */
+ISR(EE_READY_vect)
+{
+    uint8_t val;
+
+    while (hal_eeprom_len) {
+        val = *hal_eeprom_src++;
+        hal_eeprom_len--;
+
+        /* skip unchanged bytes to save time and write cycles */
+        EEAR = hal_eeprom_addr++;
+        EECR |= _BV(EERE);
+        if (EEDR != val) {
+            EEDR = val;
+            EECR |= _BV(EEMPE);
+            EECR |= _BV(EEPE);
+            return;
+        }
+    }
+
+    EECR &= ~_BV(EERIE);
+}
+
+
+#endif /* ARDUINO */
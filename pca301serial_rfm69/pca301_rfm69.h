@@ -14,31 +14,89 @@
 
 #ifndef _PCA301_h
   #define _PCA301_h
-  #if defined(ARDUINO) && ARDUINO >= 100
-    #include "Arduino.h"
-  #else
-    #include "WProgram.h"
-  #endif
+  #include "hal.h"
 #endif
 
+//- RFM69 instances, identical unless a separate RX radio is fitted --------------------------------
+extern struct rfm69 *pca301_rfm69_tx;
+extern struct rfm69 *pca301_rfm69_rx;
+
 //- Shorthand for first RFM69 data byte in rfm69_buf. ----------------------------------------------
 #define rfm69_data       (rfm69_buf)
 
 #define RFM69_MAXDATA   66              // maximum message size in bytes
+#define PCA_PAYLOAD_LEN 12              // fixed PCA301 frame length including CRC
 
 //- PCA301 device settings -------------------------------------------------------------------------
-#define PCA_MAXDEV      20              // max PCA301 devices
+#ifndef PCA_MAXDEV
+#define PCA_MAXDEV      20              // max PCA301 devices, limited by EEPROM size (about 60 on a Nano)
+#endif
 #define PCA_MAXRETRIES  5               // how often a device get's polled before considered "dead"
+#define PCA_PAIR_DELAY  70              // ms between pairing request and answer
+#define PCA_POLL_INTV   300             // default poll interval in 1/10th seconds
+#define PCA_DEAD_INTV   3000            // dead device poll retry interval in 1/10th seconds
+
+//- request tracking -------------------------------------------------------------------------------
+#define PCA_MAXREQ      8               // requests waiting for a reply
+#define PCA_RTT_INIT    40              // reply time estimate in ms before the first reply
+#define PCA_REPLY_GAP   10              // extra ms the channel is kept free for a reply
+#define PCA_TIMEOUT_MIN 100             // reply timeout range in ms, 4 * RTT within these bounds
+#define PCA_TIMEOUT_MAX 1000
+
+//- confirmed switching ----------------------------------------------------------------------------
+#ifndef PCA_MAXSW
+#define PCA_MAXSW       4               // switch commands waiting for confirmation, more are sent once
+#endif
+#define PCA_SW_TRIES    5               // transmissions before a switch command fails
+
+//- serial output ----------------------------------------------------------------------------------
+#ifndef PCA_OUT_RING
+#define PCA_OUT_RING    128             // bytes of complete lines waiting for the UART, power of 2
+#endif
+#define PCA_OUT_LINE    48              // line buffer, longer lines are queued in parts
+
+//- binary output: COBS encoded records terminated by 0 --------------------------------------------
+// type (1), timestamp in ms (4), payload, crc16 of the bytes before (2), multi-byte values MSB first
+#define PCA_BIN_MAX     PCA_OUT_LINE    // longest payload
+#define PCA_BIN_TEXT    0               // text line as printed in text mode
+#define PCA_BIN_RX      1               // crc bad (1), frame without crc (10) as in the OK line
+#define PCA_BIN_TX      2               // frame queued for sending (1..10)
+#define PCA_BIN_DEV     3               // devPtr, retries, channel, devId (3), pState, pNow (2), pTtl (2)
+#define PCA_BIN_STATS   4               // requests, replies, timeouts, txDropped, swOk, swFailed,
+                                        // outDropped, outCoalesced (4 each)
+#define PCA_BIN_HIST    5               // devPtr, samples in window, min, mean, max (2 each), then if
+                                        // samples are kept: oldest (2) and the deltas as in pcaHist
+#define PCA_BIN_SAF     6               // sequence number (2), age in seconds (2), frame as in RX (10)
+#define PCA_BIN_LOST    7               // first sequence number (2), count (2) of dropped readings
+#define PCA_BIN_RX_LEN    11
+#define PCA_BIN_DEV_LEN   11
+#define PCA_BIN_STATS_LEN 32
+#define PCA_BIN_HIST_LEN  9             // without oldest sample and deltas
+#define PCA_BIN_SAF_LEN   14
+#define PCA_BIN_LOST_LEN  4
+
+//- change-driven reports: replies are only printed when their values moved ------------------------
+#define PCA_REP_ABS     10              // default pNow change that is reported
+#define PCA_REP_REL     5               // default pNow change in percent of the last report
+#define PCA_REP_BEAT    10              // default minutes after which a reply is reported anyway
 
-//- struct for EEPROM config read/write ------------------------------------------------------------
+//- TX queue ---------------------------------------------------------------------------------------
+#ifndef PCA_TXQ_LEN
+#define PCA_TXQ_LEN     4               // frames waiting for the radio, groups leave one for commands
+#endif
+#define PCA_TXQ_DATA    10              // frame length without CRC
+
+enum {                                  // priority classes, lower ones are sent first
+  PCA_TX_SWITCH,                        // switch commands and raw frames from the serial line
+  PCA_TX_PAIR,                          // pairing replies
+  PCA_TX_POLL,                          // polls
+  PCA_TX_CLASSES
+};
+
+//- persistent device config, 4 bytes per device ---------------------------------------------------
 struct struct_pcaDev {
   uint8_t   channel;                    // associated device channel
-  uint32_t  devId;                      // device ID
-  uint8_t   pState;                     // device powered on/off
-  uint16_t  pNow;                       // actual power consumption (W)
-  uint16_t  pTtl;                       // total power consumption (KWh)
-  uint32_t  nextTX;                     // last packet submitted  
-  uint16_t  retries;                    // outstanding answers
+  uint8_t   devId[3];                   // device ID, most significant byte first
 };
 
 struct struct_pcaConf {
@@ -47,5 +105,116 @@ struct struct_pcaConf {
   uint16_t deadIntv;                    // retry intervall in 1/10th of seconds for dead devices
   uint8_t  quiet;                       // quiet mode on/off  
   struct struct_pcaDev pcaDev[PCA_MAXDEV];
-  uint16_t crc;
 };
+
+extern struct struct_pcaConf pcaConf;
+
+//- runtime device state, RAM only, one array per field --------------------------------------------
+struct struct_pcaHot {
+  uint32_t  nextTX[PCA_MAXDEV];         // next poll in 1/10th seconds
+  uint16_t  pNow[PCA_MAXDEV];           // actual power consumption (W)
+  uint16_t  pTtl[PCA_MAXDEV];           // total power consumption (KWh)
+  uint8_t   pState[PCA_MAXDEV];         // device powered on/off
+  uint8_t   retries[PCA_MAXDEV];        // polls without answer
+  uint16_t  repNow[PCA_MAXDEV];         // pNow of the last report
+  uint16_t  repTs[PCA_MAXDEV];          // time of the last report in seconds
+  uint8_t   repState[PCA_MAXDEV];       // pState of the last report
+};
+
+//- power statistics per device, RAM only ----------------------------------------------------------
+// recent pNow samples as deltas to the previous one, zigzag varint coded: 1 byte up to +-63, 2 bytes
+// up to +-8191, else 3; the oldest samples give way to new ones. min/max/mean cover the window since
+// the last "1w". Left out unless PCA_HIST is set, 20 devices take 520 bytes of a 2 KB Nano.
+#ifndef PCA_HIST
+#define PCA_HIST        0               // 1 = keep power statistics, "w" command
+#endif
+#ifndef PCA_HIST_BYTES
+#define PCA_HIST_BYTES  12              // delta bytes per device
+#endif
+
+struct struct_pcaHist {
+  uint16_t  oldest;                     // first sample, the deltas follow
+  uint8_t   samples;                    // samples kept including oldest, 0 = none yet
+  uint8_t   len;                        // delta bytes used
+  uint8_t   delta[PCA_HIST_BYTES];      // zigzag varint deltas, oldest first
+  uint16_t  min;                        // smallest sample in window
+  uint16_t  max;                        // largest sample in window
+  uint32_t  sum;                        // sum of samples in window
+  uint16_t  cnt;                        // samples in window
+};
+
+//- store-and-forward: readings kept until acknowledged, about 10 bytes each -----------------------
+// record: seconds since the previous record, devId << 1 | pState, channel, pNow, pTtl, each a varint
+// the device identity is stored, a devPtr may be erased or reused before the reading is printed.
+// Left out unless PCA_SAF is set, the queue does not fit a 2 KB Nano next to the other buffers.
+#ifndef PCA_SAF
+#define PCA_SAF         0               // 1 = store-and-forward queue, "f" and "g" commands
+#endif
+#ifndef PCA_SAF_BYTES
+#define PCA_SAF_BYTES   256             // queue size, power of 2
+#endif
+#define PCA_SAF_FIELDS  5               // varints per record
+
+//- EEPROM config log: device records appended round-robin, the newest one per device counts -------
+struct struct_pcaRec {
+  uint8_t  seq[3];                      // write sequence number, 24 bit never wrap within EEPROM life
+  uint8_t  devPtr;                      // device
+  struct struct_pcaDev dev;             // device config, devId 0 = device erased
+  uint16_t crc;                         // crc16 of the bytes above
+};
+
+#define PCA_LOG_SLOTS   (HAL_EEPROM_SIZE / sizeof(struct struct_pcaRec))
+#define PCA_LOAD_STEP   8               // log slots scanned per loop while booting
+
+//- request and TX queue statistics ----------------------------------------------------------------
+// the firmware keeps the counters of the binary stats record, the host build all of them
+#ifndef PCA_STATS
+#ifdef ARDUINO
+#define PCA_STATS       0               // 1 = all counters, about 130 bytes more RAM
+#else
+#define PCA_STATS       1
+#endif
+#endif
+
+struct struct_pcaStats {
+  uint32_t requests;                    // tracked requests sent
+  uint32_t replies;                     // replies matched to a request
+  uint32_t timeouts;                    // requests without reply
+  uint32_t txDropped;                   // frames lost to a full queue
+  uint32_t swOk;                        // confirmed switch commands
+  uint32_t swFailed;                    // switch commands never confirmed
+  uint32_t outDropped;                  // reports lost to a full output ring
+  uint32_t outCoalesced;                // reports equal to a line still queued
+#if PCA_STATS
+  uint32_t rttSum;                      // sum of matched RTTs in ms
+  uint16_t rttMax;                      // longest RTT in ms
+  uint32_t txFrames[PCA_TX_CLASSES];    // frames sent per priority class
+  uint32_t txDelaySum[PCA_TX_CLASSES];  // sum of queueing delays in ms
+  uint16_t txDelayMax[PCA_TX_CLASSES];  // longest queueing delay in ms
+  uint32_t txMerged;                    // frames replaced by a newer one for the same device
+  uint32_t txFailed;                    // frames the transceiver did not finish in time
+  uint32_t swTries;                     // transmissions of confirmed switch commands
+  uint32_t swTimeSum;                   // sum of times to confirmation in ms
+  uint16_t swTimeMax;                   // longest time to confirmation in ms
+  uint32_t grpOk;                       // group commands confirmed by all members
+  uint32_t grpFailed;                   // group commands with unconfirmed members
+  uint16_t grpTimeMax;                  // longest time to confirm a whole group in ms
+  uint32_t bootMs;                      // config loaded, polling starts
+  uint32_t firstRxMs;                   // first intact frame handled, 0 = none
+  uint32_t cmds;                        // serial commands executed
+  uint32_t outLines;                    // lines queued for the serial port
+  uint16_t outMax;                      // highest output ring fill in bytes
+  uint32_t repSent;                     // change-driven reports
+  uint32_t repSuppressed;               // replies within the thresholds, not reported
+  uint32_t repCoalesced;                // replies replacing a report still waiting
+  uint32_t repBeats;                    // reports due to the heartbeat only
+  uint32_t safStored;                   // readings queued for store-and-forward
+  uint32_t safSent;                     // readings printed, replays included
+  uint32_t safDropped;                  // readings dropped unacknowledged for new ones
+  uint32_t safLost;                     // readings dropped before they were printed once
+  uint32_t devLookups;                  // devId lookups in the device index
+  uint32_t devCompares;                 // devId compares of all lookups
+#endif
+};
+
+const struct struct_pcaStats *pca301serial_stats();
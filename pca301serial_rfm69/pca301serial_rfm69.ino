@@ -16,7 +16,7 @@
  * For files directly taken and modified from the pca301serial project please
  * read their headers for information and license details.
  */
-#include <SPI.h>
+#include "hal.h"
 #include "funky_rfm69.h"
 
 
@@ -30,11 +30,72 @@
 #define PCA301_PIN_SPI_SS           10
 #define PCA301_PIN_INT              2
 
+/* optional second RFM69 that stays in RX while the first one transmits */
+#ifndef PCA301_DUAL_RADIO
+#  define PCA301_DUAL_RADIO         false
+#endif
+#define PCA301_PIN_SPI_SS_RX        8
+#define PCA301_PIN_INT_RX           3
+
 
 /*****************************************************************************/
 /* Local variables */
 /*****************************************************************************/
-static uint8_t pca301_sync_values[] = { 0x2d, 0xd4 }; /**< sync word values */
+RFM69_INSTANCE(pca301_radio)                    /**< transmitting RFM69 */
+#if PCA301_DUAL_RADIO
+RFM69_INSTANCE(pca301_radio_rx)                 /**< receive-only RFM69 */
+#endif
+
+static const struct rfm69_reg_field pca301_rfm69_config[] PROGMEM = {
+
+    /* frequency: 868.950 MHz */
+    RFM69_CFG_FREQ_KHZ(PCA301_FREQ_CARRIER_KHZ),
+
+    /* bitrate: 6.631 kb/s */
+    RFM69_CFG_BITRATE_BS(PCA301_BITRATE_BS),
+
+    /* frequency deviation in Hz */
+    RFM69_CFG_FDEV_HZ(45000),
+
+    /* disable CLKOUT to save power */
+    RFM69_CFG_CLKOUT(RFM69_CLKOUT_OFF),
+
+    /* configure CRC */
+    RFM69_CFG_CRC_ON(false),
+    RFM69_CFG_CRC_AUTO_CLEAR_OFF(true),
+
+    /* payload length */
+    RFM69_CFG_PAYLOAD_LENGTH(12),
+
+    /* sync word */
+    RFM69_CFG_SYNC_SIZE(2),
+    RFM69_CFG_SYNC_VALUE(0, 0x2d),
+    RFM69_CFG_SYNC_VALUE(1, 0xd4),
+    RFM69_CFG_SYNC_ON(true),
+
+    /* RX bandwidth exponent */
+    RFM69_CFG_RX_BW_EXP(2),
+
+    /* RSSI threshold */
+    RFM69_CFG_RSSI_THRESHOLD(0xdc),
+
+    /* variable length packet format */
+    RFM69_CFG_PACKET_FORMAT_VAR_LEN(false),
+
+    /* TX start condition */
+    RFM69_CFG_TX_START_COND(RFM69_FIFO_NOT_EMPTY),
+}; /**< PCA301 register configuration */
+
+
+/*****************************************************************************/
+/* Global variables */
+/*****************************************************************************/
+struct rfm69 *pca301_rfm69_tx = &pca301_radio;  /**< RFM69 used for sending */
+#if PCA301_DUAL_RADIO
+struct rfm69 *pca301_rfm69_rx = &pca301_radio_rx; /**< RFM69 used for receiving */
+#else
+struct rfm69 *pca301_rfm69_rx = &pca301_radio;  /**< RFM69 used for receiving */
+#endif
 
 
 /*****************************************************************************/
@@ -45,7 +106,8 @@ static void pca301_board_init(
 );
 
 static void pca301_rfm69_init(
-    void
+    struct rfm69 *dev,                          /**< instance */
+    uint8_t opmode                              /**< mode when idle */
 );
 
 
@@ -82,6 +144,7 @@ void loop(
 )
 {
     rfm69_timer_loop();
+    rfm69_send_loop(pca301_rfm69_tx);
     pca301serial_loop();
 }
 
@@ -93,18 +156,28 @@ static void pca301_board_init(
     void
 )
 {
-    /* initialize Serial communication */
-    Serial.begin(PCA301_SERIAL_SPEED_BPS);
-    while (!Serial);
-
-    /* initialize RFM69 for PCA301 */
-    pca301_rfm69_init();
-
-    /* configure IRQ for RFM69 */
-    pinMode(PCA301_PIN_INT, INPUT);
+    /* initialize Serial communication, without waiting for a host so the
+     * radio receives right away
+     */
+    hal_serial_init(PCA301_SERIAL_SPEED_BPS);
+
+    /* initialize RFM69 for PCA301, with two modules the first one only
+     * leaves STANDBY to send
+     */
+#if PCA301_DUAL_RADIO
+    rfm69_init(&pca301_radio, PCA301_PIN_SPI_SS, PCA301_PIN_INT, pca301_radio_isr, RFM69_IS_HW);
+    pca301_rfm69_init(&pca301_radio, RFM69_OPMODE_STANDBY);
+
+    rfm69_init(&pca301_radio_rx, PCA301_PIN_SPI_SS_RX, PCA301_PIN_INT_RX, pca301_radio_rx_isr, RFM69_IS_HW);
+    pca301_rfm69_init(&pca301_radio_rx, RFM69_OPMODE_RX);
+    rfm69_int_enable(&pca301_radio_rx);
+#else
+    rfm69_init(&pca301_radio, PCA301_PIN_SPI_SS, PCA301_PIN_INT, pca301_radio_isr, RFM69_IS_HW);
+    pca301_rfm69_init(&pca301_radio, RFM69_OPMODE_RX);
+#endif
 
     /* enable interrupts */
-    rfm69_int_enable();
+    rfm69_int_enable(&pca301_radio);
 }
 
 
@@ -112,79 +185,23 @@ static void pca301_board_init(
 /** RFM69 Initialization
  */
 static void pca301_rfm69_init(
-    void
+    struct rfm69 *dev,                          /**< instance */
+    uint8_t opmode                              /**< mode when idle */
 )
 {
-    /* configure RFM69 SPI */
-    rfm69_init(PCA301_PIN_SPI_SS, RFM69_IS_HW);
-
     /* put transceiver in standby mode */
-    rfm69_opmode_set(RFM69_OPMODE_STANDBY);
-
-    /* frequency: 868.950 MHz */
-    rfm69_freq_carrier_khz(PCA301_FREQ_CARRIER_KHZ);
-
-    /* bitrate: 6.631 kb/s */
-    rfm69_bitrate_bs(PCA301_BITRATE_BS);
+    rfm69_opmode_set(dev, RFM69_OPMODE_STANDBY);
 
     /* configure RX and TX interrupt generators */
-    rfm69_dio_mapping_rx(0, RFM69_DIO0_RX_PAYLOADREADY_TX_TXREADY);
-    rfm69_dio_mapping_tx(0, RFM69_DIO0_RX_CRCOK_TX_PACKETSENT);
-
-    /* disable CLKOUT to save power */
-    rfm69_clkout(RFM69_CLKOUT_OFF);
-
-    /* configure CRC */
-    rfm69_crc_on(false);
-    rfm69_crc_auto_clear_off(true);
-
-    /* set payload length */
-    rfm69_payload_length(12);
-
-    /* configure sync word */
-    rfm69_sync_word(2, pca301_sync_values);
-    rfm69_sync_on(true);
-
-    /* RX bandwidth exponent */
-    rfm69_rx_bw_exp(2);
-
-    /* RSSI threshold */
-    rfm69_rssi_threshold(0xdc);
-
-    /* variable length packet format */
-    rfm69_packet_format_var_len(false);
-
-    /* TX start condition */
-    rfm69_tx_start_cond(RFM69_FIFO_NOT_EMPTY);
+    rfm69_dio_mapping_rx(dev, 0, RFM69_DIO0_RX_PAYLOADREADY_TX_TXREADY);
+    rfm69_dio_mapping_tx(dev, 0, RFM69_DIO0_RX_CRCOK_TX_PACKETSENT);
 
-    /* set frequency deviation in Hz */
-    rfm69_fdev_hz(45000);
+    /* write PCA301 register configuration */
+    rfm69_config(dev, pca301_rfm69_config, sizeof(pca301_rfm69_config) / sizeof(pca301_rfm69_config[0]));
 
-    /* enable receiver mode */
-    rfm69_opmode_set(RFM69_OPMODE_RX);
+    /* enable idle mode */
+    rfm69_opmode_set(dev, opmode);
 
     /* clear fifo */
-    rfm69_fifo_clear();
-}
-
-
-/*****************************************************************************/
-/** RFM69 Interrupt Enable
- */
-void rfm69_int_enable(
-    void
-)
-{
-    attachInterrupt(digitalPinToInterrupt(PCA301_PIN_INT), rfm69_isr, RISING);
-}
-
-
-/*****************************************************************************/
-/** RFM69 Interrupt Disable
- */
-void rfm69_int_disable(
-    void
-)
-{
-    detachInterrupt(digitalPinToInterrupt(PCA301_PIN_INT));
+    rfm69_fifo_clear(dev);
 }
@@ -62,8 +62,10 @@
 // 2 Byte: CRC16 (CRC16 XMODEM with Polynom 8005h)
 //
 
-#include <SPI.h>
+#include <stddef.h>
+#include "hal.h"
 #include "funky_rfm69.h"
+#include "crc16_pca301.h"
 #include "pca301_rfm69.h"
 
 #define SERIAL_BAUD      57600
@@ -76,136 +78,485 @@
 #define RF_MAX   (RFM69_MAXDATA + 5)    // maximum transmit / receive buffer: 3 header + data + 2 crc bytes
 #define RF_FREQ_BASE     868000         // frequency base
 
+static_assert(PCA_PAYLOAD_LEN <= RF_MAX, "PCA301 frame exceeds RX buffer");
+static_assert(PCA_MAXDEV < 255, "devPtr is 8 bit");
+static_assert(PCA_LOG_SLOTS > PCA_MAXDEV, "PCA_MAXDEV exceeds EEPROM log slots");
+#if PCA_HIST
+static_assert(PCA_HIST_BYTES >= 3, "a delta takes up to 3 bytes");
+static_assert(PCA_BIN_HIST_LEN + 2 + PCA_HIST_BYTES <= PCA_BIN_MAX, "PCA_HIST_BYTES exceeds a binary record");
+#endif
+#if PCA_SAF
+static_assert((PCA_SAF_BYTES & (PCA_SAF_BYTES - 1)) == 0 && PCA_SAF_BYTES >= 32, "PCA_SAF_BYTES must be a power of 2");
+#endif
+
+//- counters of the full statistics, see PCA_STATS ------------------------------------------------
+#if PCA_STATS
+#define PCA_STAT(x)      x
+#else
+#define PCA_STAT(x)      ((void) 0)
+#endif
+
+//- device index size: power of two, at most half full so probing stays short ----------------------
+static constexpr uint16_t devIdxSize(uint16_t n, uint16_t size = 4) {
+  return (size >= 2 * n) ? size : devIdxSize(n, size * 2);
+}
+#define DEVIDX_SIZE      devIdxSize(PCA_MAXDEV)
+
+//- long command replies, printed a line per loop by outJobTask() ----------------------------------
+#define OUT_JOB_HELP     1              // help text
+#define OUT_JOB_LIST     2              // L lines of all devices
+#define OUT_JOB_REC      3              // R lines of all devices
+#define OUT_JOB_HIST     4              // W lines of all devices
+#define OUT_JOB_HIST_NEW 5              // W lines, each device starts a new window
+#define OUT_JOB_ROOM     120            // free ring bytes for the next line: W lines take up to 115, help
+                                        // lines in binary mode two records of up to PCA_BIN_MAX + 9
+#define OUT_ROOM         (2 * PCA_OUT_LINE) // free ring bytes for a report, F lines come in two parts
+
+static_assert(PCA_OUT_RING >= OUT_JOB_ROOM, "PCA_OUT_RING is too small for a long command reply");
+static_assert(OUT_JOB_ROOM >= 2 * (PCA_BIN_MAX + 9), "binary help lines exceed OUT_JOB_ROOM");
+#if PCA_HIST
+static_assert(37 + 6 * (PCA_HIST_BYTES + 1) <= OUT_JOB_ROOM, "W lines exceed OUT_JOB_ROOM");
+#endif
+
 
 //- variables --------------------------------------------------------------------------------------
-static char cmd;
-static String freq;
-static byte value, stack[RFM69_MAXDATA+4], top, sendLen;
-static byte pBuf[RFM69_MAXDATA], mode;
+static uint16_t freqHex;                 // hex digits of the 0x<hhhh> h argument
+static byte freqMode;                    // collecting hex digits after "0x"
+static byte value, stack[RFM69_MAXDATA+4], top;
+static byte pBuf[PCA_PAYLOAD_LEN];
 struct_pcaConf pcaConf;
-uint16_t eeprom_crc;                     // eeprom crc
+static struct_pcaHot pcaHot;
+#if PCA_HIST
+static struct_pcaHist pcaHist[PCA_MAXDEV];
+#endif
+static uint16_t loadSlot = PCA_LOG_SLOTS; // next log slot to scan, PCA_LOG_SLOTS = config loaded
+static byte loadFound;                   // intact log record seen
+static byte loadDue;                     // reload asked for, starts once pending records are written
+static byte helpDue;                     // help banner not shown yet
+static char outRing[PCA_OUT_RING];       // complete lines waiting for the UART
+static uint16_t outHead, outCnt;         // oldest queued byte, queued bytes
+static uint8_t outLastLen;               // length of the newest queued line
+static char outBuf[PCA_OUT_LINE];        // line being built
+static uint8_t outLen;
+static uint8_t outJob;                   // long command reply being printed, 0 = none
+static uint8_t outJobDev;                // next device of outJob
+static PGM_P outJobText;                 // next line of the help text
+static byte outBin;                      // binary records instead of text lines
+static byte repMode;                     // change-driven reports instead of every reply
+static uint8_t repAbs = PCA_REP_ABS;     // reported pNow change
+static uint8_t repRel = PCA_REP_REL;     // reported pNow change in percent of the last report
+static uint8_t repBeat = PCA_REP_BEAT;   // minutes after which a reply is reported anyway
+static uint8_t repDue[(PCA_MAXDEV + 7) / 8];   // devices with a report waiting for the output ring
+static uint8_t repKnown[(PCA_MAXDEV + 7) / 8]; // devices reported since boot
+static uint8_t repCnt;                   // waiting reports
+static uint8_t repNext;                  // device the report task looks at first
+static byte rxShown;                     // frame in rfm69_buf was printed in full
+static uint16_t drvOpmodeTo, drvSendTo;  // transceiver timeouts already reported
+static byte safMode;                     // readings go through the store-and-forward queue, 0 without PCA_SAF
+#if PCA_SAF
+static uint8_t safRing[PCA_SAF_BYTES];   // records of varints, see pca301_rfm69.h
+static uint16_t safTail, safLen;         // oldest record, bytes used
+static uint16_t safCnt;                  // records kept
+static uint16_t safSeq;                  // sequence number of the oldest record
+static uint32_t safTs, safHeadTs;        // time of the oldest and the newest record in seconds
+static uint16_t safSend, safSendOff;     // next record to print: index and byte offset from the oldest
+static uint32_t safSendTs;               // time of the record before it
+static uint16_t safLost, safLostSeq;     // dropped readings not announced yet, the first of them
+#endif
 uint16_t rfm69_crc = 0;                  // running crc value
 uint8_t  rfm69_buf[RF_MAX];              // recv/xmit buf, including hdr & crc bytes
 uint8_t  rxfill = 0;                     // RX fill level
 uint8_t  rfm69_len = 7;                  // fixed calculation value
 uint32_t rfm69_center_freq = 868950;     // center frequency
+static uint8_t txEcho[PCA_PAYLOAD_LEN];  // last sent frame, dropped when the RX radio hears it
+static uint8_t txEchoLen = 0;            // txEcho valid if non-zero
+static uint8_t devIdx[DEVIDX_SIZE];      // devId hash -> devPtr, 0 = empty
+static uint8_t schedHeap[PCA_MAXDEV];    // poll scheduler min-heap of devPtr, earliest nextTX first
+static uint8_t schedPos[PCA_MAXDEV];     // heap position + 1 per device, 0 = not queued
+static uint8_t schedCnt = 0;             // queued devices
+static uint16_t rndState = 1;            // xorshift PRNG state, never 0
+static unsigned long rxTs;               // receive time of frame in rfm69_buf
+static uint8_t pairDev = 0;              // device waiting for its pairing answer, 0 = none
+static uint16_t logSlot[PCA_MAXDEV];     // EEPROM slot + 1 of the newest record per device, 0 = none
+static uint8_t logLive[(PCA_LOG_SLOTS + 7) / 8]; // slots holding the newest record of a device
+static uint8_t logDirty[(PCA_MAXDEV + 7) / 8];   // devices whose record must be written
+static uint16_t logHead = 0;             // next slot to write
+static uint32_t logSeq = 0;              // sequence number of the next record
+static struct_pcaRec logRec;             // record being written in the background
+static unsigned long pairDue;            // time to send the pairing answer
+
+//- outstanding requests, keyed by devPtr + command ------------------------------------------------
+struct struct_pcaReq {
+  uint8_t       devPtr;                  // device, 0 = free
+  uint8_t       cmd;                     // PCA301 command byte
+  uint8_t       sent;                    // transmission finished, ts valid
+  unsigned long ts;                      // end of transmission
+};
+static struct struct_pcaReq reqTab[PCA_MAXREQ];
+static uint8_t reqCnt = 0;               // used entries
+static uint8_t reqTx = 0;                // entry + 1 of the frame on air
+static uint8_t replyWaitDev = 0;         // device whose reply keeps polls back
+static unsigned long replyWaitUntil;     // end of reply window
+static uint16_t devRtt[PCA_MAXDEV];      // RTT average per device in ms, 0 = unknown
+static uint16_t rttAvg = PCA_RTT_INIT;   // RTT average of all devices in ms
+static struct struct_pcaStats pcaStats;
+
+//- TX queue, ordered by priority class, FIFO within a class ---------------------------------------
+struct struct_pcaTx {
+  uint8_t       prio;                    // priority class
+  uint8_t       devPtr;                  // addressed device, 0 = unknown
+  uint8_t       len;                     // frame length without CRC
+  uint8_t       data[PCA_TXQ_DATA];
+  unsigned long ts;                      // time queued
+};
+static struct struct_pcaTx txq[PCA_TXQ_LEN];
+static uint8_t txqCnt = 0;               // queued frames
+
+//- switch commands waiting for a reply with the desired state, keyed by devPtr --------------------
+struct struct_pcaSw {
+  uint8_t       devPtr;                  // device, 0 = free
+  uint8_t       state;                   // desired pState
+  uint8_t       tries;                   // transmissions so far
+  unsigned long start;                   // first transmission queued
+  unsigned long due;                     // next retransmission
+};
+static struct struct_pcaSw swTab[PCA_MAXSW];
+static uint8_t swCnt = 0;                // used entries
+static uint8_t swConfirm = 1;            // confirmed switching on/off, 2 = with #SWITCH lines
+
+//- group switching, one group at a time -----------------------------------------------------------
+static uint8_t grpPend[(PCA_MAXDEV + 7) / 8]; // members not confirmed yet, bit 0 = devPtr 1
+static uint8_t grpCnt = 0;               // members, 0 = no group
+static uint8_t grpOk;                    // confirmed members
+static uint8_t grpState;                 // desired pState
+static uint8_t grpTries;                 // transmission round
+static uint8_t grpNext;                  // next devPtr of the round
+static unsigned long grpStart;           // group command received
+static unsigned long grpDue;             // end of the reply wait after a round, 0 = round running
 
 
 //- prototypes -------------------------------------------------------------------------------------
 static void sendDevice(uint8_t devPtr, char cmd);
+static uint8_t txqAdd(uint8_t prio, uint8_t devPtr, const uint8_t *data, uint8_t len);
+static void txqSend();
 static void showByte (byte value);
+static void outChar(char c);
+static void outStr(const char *s);
+static void outDec(uint32_t value);
+static void outLn();
+static void outRec(uint8_t type, const uint8_t *data, uint8_t len);
+static uint8_t *putLong(uint8_t *p, uint32_t value);
+static void reportStats();
+#if PCA_HIST
+static void reportHist(uint8_t reset);
+static void histAdd(uint8_t devPtr, uint16_t value);
+static uint8_t histDelta(const uint8_t *p, uint16_t *value);
+#endif
+static void outJobTask();
+static void showRX(uint8_t bad, const uint8_t *frame);
+static byte rxValues();
+static byte repHold();
+static void repUpdate(uint8_t devPtr);
+static void repTask();
+static void drvTask();
+#if PCA_SAF
+static void safAdd(uint8_t i);
+static void safAck(uint16_t seq, uint8_t replay);
+static void safTask();
+#endif
+static void outTask();
 static uint8_t getDevice(uint32_t devId);
+static void devIdxAdd(uint8_t devPtr);
+static void devIdxBuild();
+static void schedSet(uint8_t devPtr, uint32_t nextTX);
+static void schedBuild();
+static uint8_t jitter(uint8_t range);
+static uint8_t reqAdd(uint8_t devPtr, uint8_t cmd);
+static void reqReply(uint8_t devPtr, uint8_t cmd);
+static void reqCheck();
+static bool replyWait(unsigned long now);
+static void swAdd(uint8_t devPtr, uint8_t state);
+static void swReply(uint8_t devPtr, uint8_t state);
+static void swCheck();
+static void swDrop(uint8_t devPtr);
+static void grpDrop(uint8_t devPtr);
+static void grpAdd(const uint8_t *mask, uint8_t len, uint8_t state);
+static void grpTask();
 static uint32_t mem2devId(volatile uint8_t * data);
+static uint32_t devIdOf(uint8_t devPtr);
+static void devIdSet(uint8_t devPtr, uint32_t devId);
+static byte devUsed(uint8_t devPtr);
+static uint8_t devFree();
 static uint32_t mem2long(volatile uint8_t * data);
 static uint16_t mem2word(volatile uint8_t * data);
 static void displayVersion(uint8_t newline);
-static uint16_t hexToUInt16(String hexString);
+static int8_t hexDigit(char c);
+static void loadBegin();
+static byte loadStep();
 static byte loadConf();
+static void loadTask();
 static void saveConf();
 static void eraseConf();
 static void fillConf();
-static uint16_t crc16_pca301_update(uint16_t crc, uint8_t data);
+static void confChanged(uint8_t devPtr);
+static void confTask();
+static void setFreq(uint32_t khz);
 
 
-//- report pcaConf ---------------------------------------------------------------------------------
+//- report pcaConf, outJobTask() prints the devices one per loop -----------------------------------
 void reportConf(uint8_t repMode) {
-  for (int i = 0; i < pcaConf.numDev; i++) {
-    switch (repMode) {
-      case 1:
-        Serial.print("L ");
-        Serial.print(NODEID);
-        Serial.print(' ');
-        Serial.print(i+1);
-        Serial.print(' ');
-        break;
-      case 2:
-        Serial.print("R ");
-        break;
-      default:
-        break;
+  outJob = (repMode == 1) ? OUT_JOB_LIST : OUT_JOB_REC;
+  outJobDev = 0;
+}
+
+//- report one device of pcaConf -------------------------------------------------------------------
+static void reportDev(uint8_t repMode, uint8_t i) {
+  if (outBin) {
+    uint8_t dev[PCA_BIN_DEV_LEN] = {
+      (uint8_t)(i + 1), pcaHot.retries[i], pcaConf.pcaDev[i].channel,
+      pcaConf.pcaDev[i].devId[0], pcaConf.pcaDev[i].devId[1], pcaConf.pcaDev[i].devId[2],
+      pcaHot.pState[i], (uint8_t)(pcaHot.pNow[i] >> 8), (uint8_t)pcaHot.pNow[i],
+      (uint8_t)(pcaHot.pTtl[i] >> 8), (uint8_t)pcaHot.pTtl[i]
+    };
+    outRec(PCA_BIN_DEV, dev, sizeof dev);
+    return;
+  }
+  switch (repMode) {
+    case 1:
+      outStr("L ");
+      outDec(NODEID);
+      outChar(' ');
+      outDec(i+1);
+      outChar(' ');
+      break;
+    case 2:
+      outStr("R ");
+      break;
+    default:
+      break;
+  }
+  outDec(pcaHot.retries[i]);
+  outStr(" : ");
+  outDec(pcaConf.pcaDev[i].channel);
+  outStr(" 4 ");
+  outDec(pcaConf.pcaDev[i].devId[0]);
+  outChar(' ');
+  outDec(pcaConf.pcaDev[i].devId[1]);
+  outChar(' ');
+  outDec(pcaConf.pcaDev[i].devId[2]);
+  outChar(' ');
+  outDec(pcaHot.pState[i]);
+  outChar(' ');
+  outDec((byte)(pcaHot.pNow[i] >> 8));
+  outChar(' ');
+  outDec((byte)(pcaHot.pNow[i]));
+  outChar(' ');
+  outDec((byte)(pcaHot.pTtl[i] >> 8));
+  outChar(' ');
+  outDec((byte)(pcaHot.pTtl[i]));
+  outLn();
+}
+
+//- report counters as a binary record -------------------------------------------------------------
+static void reportStats() {
+  uint8_t rec[PCA_BIN_STATS_LEN], *p = rec;
+
+  p = putLong(p, pcaStats.requests);
+  p = putLong(p, pcaStats.replies);
+  p = putLong(p, pcaStats.timeouts);
+  p = putLong(p, pcaStats.txDropped);
+  p = putLong(p, pcaStats.swOk);
+  p = putLong(p, pcaStats.swFailed);
+  p = putLong(p, pcaStats.outDropped);
+  p = putLong(p, pcaStats.outCoalesced);
+  outRec(PCA_BIN_STATS, rec, sizeof rec);
+}
+
+#if PCA_HIST
+//- report power statistics, optionally start a new window, one device per loop --------------------
+static void reportHist(uint8_t reset) {
+  outJob = reset ? OUT_JOB_HIST_NEW : OUT_JOB_HIST;
+  outJobDev = 0;
+}
+
+//- report power statistics of one device ----------------------------------------------------------
+static void reportHistDev(uint8_t i, uint8_t reset) {
+  struct_pcaHist *h = &pcaHist[i];
+  uint16_t mean = h->cnt ? h->sum / h->cnt : 0;
+
+  if (outBin) {
+    uint8_t rec[PCA_BIN_HIST_LEN + 2 + PCA_HIST_BYTES] = {
+      (uint8_t)(i + 1), (uint8_t)(h->cnt >> 8), (uint8_t)h->cnt,
+      (uint8_t)(h->min >> 8), (uint8_t)h->min, (uint8_t)(mean >> 8), (uint8_t)mean,
+      (uint8_t)(h->max >> 8), (uint8_t)h->max, (uint8_t)(h->oldest >> 8), (uint8_t)h->oldest
+    };
+    memcpy(rec + PCA_BIN_HIST_LEN + 2, h->delta, h->len);
+    outRec(PCA_BIN_HIST, rec, h->samples ? PCA_BIN_HIST_LEN + 2 + h->len : PCA_BIN_HIST_LEN);
+  } else {
+    outStr("W ");
+    outDec(NODEID);
+    outChar(' ');
+    outDec(i + 1);
+    outChar(' ');
+    outDec(h->cnt);
+    outChar(' ');
+    outDec(h->min);
+    outChar(' ');
+    outDec(mean);
+    outChar(' ');
+    outDec(h->max);
+    outStr(" :");
+
+    // samples oldest first
+    uint16_t value = h->oldest;
+    for (uint8_t n = 0, pos = 0; n < h->samples; n++) {
+      if (n)
+        pos += histDelta(h->delta + pos, &value);
+      outChar(' ');
+      outDec(value);
     }
-    Serial.print(pcaConf.pcaDev[i].retries);
-    Serial.print(" : ");
-    Serial.print(pcaConf.pcaDev[i].channel);
-    Serial.print(" 4 ");
-    Serial.print((byte)(pcaConf.pcaDev[i].devId >> 16));
-    Serial.print(' ');
-    Serial.print((byte)(pcaConf.pcaDev[i].devId >> 8));
-    Serial.print(' ');
-    Serial.print((byte)(pcaConf.pcaDev[i].devId));
-    Serial.print(' ');
-    Serial.print(pcaConf.pcaDev[i].pState);
-    Serial.print(' ');
-    Serial.print((byte)(pcaConf.pcaDev[i].pNow >> 8));
-    Serial.print(' ');
-    Serial.print((byte)(pcaConf.pcaDev[i].pNow));
-    Serial.print(' ');
-    Serial.print((byte)(pcaConf.pcaDev[i].pTtl >> 8));
-    Serial.print(' ');
-    Serial.print((byte)(pcaConf.pcaDev[i].pTtl));
-    Serial.println();
+    outLn();
+  }
+  if (reset) {
+    h->cnt = 0;
+    h->sum = 0;
   }
 }
+#endif
 
 //- modify pcaConf ---------------------------------------------------------------------------------
 void modifyConf(volatile uint8_t value) {
   switch (value) {
     case 0: fillConf();  break;
-    case 1: loadConf();  break;
+    case 1: loadDue = 1; break;     // loadTask() reloads once the EEPROM is up to date
     case 2: saveConf();  break;
     case 3: eraseConf(); break;
   };
 }
 
-//- pcaTask ----------------------------------------------------------------------------------------
+//- pcaTask: poll the device with the earliest passed deadline -------------------------------------
 void pcaTask() {
-  for (int i = 0; i < pcaConf.numDev; i++) {
-    if (millis() / 100 > pcaConf.pcaDev[i].nextTX) {
-      if (pcaConf.pcaDev[i].retries <= 255)
-        pcaConf.pcaDev[i].retries += 1;
-      if (pcaConf.pcaDev[i].retries < PCA_MAXRETRIES)
-        pcaConf.pcaDev[i].nextTX = millis() / 100 + random(0,30) + 10;
-      else
-        pcaConf.pcaDev[i].nextTX = millis() / 100 + random(0,30) + pcaConf.deadIntv;
-      sendDevice(i+1,'p');
-      cmd = 'p';
-      return;
+  if (!schedCnt || reqCnt >= PCA_MAXREQ)
+    return;
+
+  // one poll at a time, it's queued behind everything else anyway
+  if (txqCnt && txq[txqCnt-1].prio == PCA_TX_POLL)
+    return;
+
+  uint8_t devPtr = schedHeap[0];
+  unsigned long now = hal_millis();
+
+  if (now / 100 <= pcaHot.nextTX[devPtr-1])
+    return;
+
+  if (replyWait(now))
+    return;
+
+  // reply or timeout reschedule the device
+  schedSet(devPtr, now / 100 + pcaConf.deadIntv);
+  sendDevice(devPtr,'p');
+}
+  
+//- show frame queued for sending ------------------------------------------------------------------
+static void showTX(const uint8_t *data, uint8_t len) {
+  if (outBin && !pcaConf.quiet) {
+    outRec(PCA_BIN_TX, data, len);
+  } else if (!pcaConf.quiet) {
+    outStr("TX ");
+    outDec(NODEID);
+    for (byte i = 0; i < len; i++) {
+      outChar(' ');
+      showByte(data[i]);
     }
+    outLn();
   }
 }
-  
+
+//- show received frame without crc, frame[0] is the channel to report -----------------------------
+static void showRX(uint8_t bad, const uint8_t *frame) {
+  if (outBin) {
+    // CRC result and the fields of the text line
+    uint8_t rx[PCA_BIN_RX_LEN];
+    rx[0] = bad;
+    memcpy(rx + 1, frame, PCA_BIN_RX_LEN - 1);
+    outRec(PCA_BIN_RX, rx, sizeof rx);
+    return;
+  }
+  outStr(bad ? " ?" : "OK");
+  outChar(' ');
+  outDec(NODEID);
+  for (byte i = 0; i < PCA_PAYLOAD_LEN - 2; i++) {
+    outChar(' ');
+    showByte(frame[i]);
+  }
+  outLn();
+}
+
 //- send device ------------------------------------------------------------------------------------
 void sendDevice(uint8_t devPtr, char cmd) {
-  
-  if (--devPtr >= 0 && devPtr < pcaConf.numDev) {
-    pBuf[0] = pcaConf.pcaDev[devPtr].channel;
+  uint8_t frame[PCA_TXQ_DATA];
+  uint8_t prio;
+
+  if (devUsed(devPtr)) {
+    struct_pcaDev *dev = &pcaConf.pcaDev[devPtr-1];
+    frame[0] = dev->channel;
     switch (cmd) {
-      case    'p': pBuf[1] = 4;  break;   // poll
-      case    'j': pBuf[1] = 17; break;   // pair
-      default    : pBuf[1] = 5;           // switch
+      case    'p': frame[1] = 4;  prio = PCA_TX_POLL;   break;   // poll
+      case    'j': frame[1] = 17; prio = PCA_TX_PAIR;   break;   // pair
+      default    : frame[1] = 5;  prio = PCA_TX_SWITCH;          // switch
     }
-    pBuf[2] = pcaConf.pcaDev[devPtr].devId >> 16;
-    pBuf[3] = pcaConf.pcaDev[devPtr].devId >> 8;
-    pBuf[4] = pcaConf.pcaDev[devPtr].devId;
+    memcpy(frame+2, dev->devId, 3);
 
     if (cmd == 'e')
-      pBuf[5] = 1;  // turn "on" (with byte 1 set to 5)
+      frame[5] = 1;  // turn "on" (with byte 1 set to 5)
     else
-      pBuf[5] = 0;  // turn "off" (with byte 1 set to 5)
-    pBuf[6] = pBuf[7] = pBuf[8] = pBuf[9] = 0xFF;
+      frame[5] = 0;  // turn "off" (with byte 1 set to 5)
+    frame[6] = frame[7] = frame[8] = frame[9] = 0xFF;
 
-    sendLen = 10;
+    if (txqAdd(prio, devPtr, frame, sizeof frame))
+      showTX(frame, sizeof frame);
+  }
+}
 
-    if (!pcaConf.quiet) {
-      Serial.print("TX ");
-      Serial.print(NODEID);
-      for (byte i = 0; i < sendLen; i++) {
-        Serial.print(' ');
-        showByte(pBuf[i]);
+//- queue frame, a newer one replaces a queued frame with the same command for the same device -----
+static uint8_t txqAdd(uint8_t prio, uint8_t devPtr, const uint8_t *data, uint8_t len) {
+  uint8_t pos;
+
+  if (devPtr) {
+    for (pos = 0; pos < txqCnt; pos++) {
+      if (txq[pos].devPtr == devPtr && txq[pos].prio == prio && txq[pos].data[1] == data[1]) {
+        memcpy(txq[pos].data, data, len);   // keeps its place and queueing time
+        txq[pos].len = len;
+        PCA_STAT(pcaStats.txMerged++);
+        return 1;
       }
-      Serial.println();
     }
-    
+  }
+
+  // full queue: the newest frame of the lowest class gives way if it ranks below
+  if (txqCnt >= PCA_TXQ_LEN) {
+    pcaStats.txDropped++;
+    if (txq[txqCnt-1].prio <= prio)
+      return 0;
+    txqCnt--;
+  }
+
+  for (pos = txqCnt; pos && txq[pos-1].prio > prio; pos--)
+    txq[pos] = txq[pos-1];
+  txq[pos].prio   = prio;
+  txq[pos].devPtr = devPtr;
+  txq[pos].len    = len;
+  txq[pos].ts     = hal_millis();
+  memcpy(txq[pos].data, data, len);
+  txqCnt++;
+  return 1;
+}
+
+//- send pairing answer once its delay passed ------------------------------------------------------
+static void pairTask() {
+  if (pairDev && (long)(hal_millis() - pairDue) >= 0) {
+    sendDevice(pairDev,'j');
+    pairDev = 0;
   }
 }
 
@@ -213,7 +564,7 @@ void sendDevice(uint8_t devPtr, char cmd) {
 void setNextTX (uint32_t devId, uint8_t nextTX) {
   uint8_t devPtr = getDevice(devId);
   if (devPtr)
-    pcaConf.pcaDev[devPtr-1].nextTX  = millis() / 100 + nextTX;
+    schedSet(devPtr, hal_millis() / 100 + nextTX);
   return;
 }
 
@@ -222,61 +573,793 @@ static void analyzePacket (void) {
 
   uint32_t devId = mem2devId(rfm69_buf+2);
   uint8_t devPtr = getDevice(devId);
-  byte confChanged = 0;
 
   //- unknown device? add it to pcaConf ------------------------------------------------------------
   if (!devPtr) {
-    devPtr = ++pcaConf.numDev;
-    pcaConf.pcaDev[devPtr-1].devId = devId;
+    devPtr = devFree();
+    if (!devPtr)
+      return;                           // no room left, ignore device
+    devIdSet(devPtr, devId);
+    devIdxAdd(devPtr);
+#if PCA_HIST
+    memset(&pcaHist[devPtr-1], 0, sizeof pcaHist[0]);
+#endif
+    schedSet(devPtr, 0);                // poll new device right away
     //- is this device already paired with a handheld display unit? --------------------------------
     if (rfm69_buf[0]) {
       //- device is paired to handheld display unit, therefore use same channel --------------------
       pcaConf.pcaDev[devPtr-1].channel = rfm69_buf[0];
     } else {
       //- device is not paired to an handheld display unit, assign a free channel ------------------
-      pcaConf.pcaDev[devPtr-1].channel = pcaConf.numDev;
+      pcaConf.pcaDev[devPtr-1].channel = devPtr;
     }
-    confChanged = 1;
+    confChanged(devPtr);
   } else if (rfm69_buf[0] && pcaConf.pcaDev[devPtr-1].channel != rfm69_data[0]) {
       //- known device, but used channel is different -> update config in memory -------------------
       pcaConf.pcaDev[devPtr-1].channel = rfm69_buf[0];
-      confChanged = 1;
+      confChanged(devPtr);
   }
 
   //- update dynamic values ------------------------------------------------------------------------
-  if (mem2long(rfm69_buf+6) != 0xAAAAAAAA && mem2long(rfm69_data+6) != 0xFFFFFFFF) {
-    pcaConf.pcaDev[devPtr-1].pState  = rfm69_buf[5]; 
-    pcaConf.pcaDev[devPtr-1].pNow    = mem2word(rfm69_buf+6);
-    pcaConf.pcaDev[devPtr-1].pTtl    = mem2word(rfm69_buf+8);
-    pcaConf.pcaDev[devPtr-1].nextTX  = millis() / 100 + random(0,30) + pcaConf.pollIntv;
-    pcaConf.pcaDev[devPtr-1].retries = 0;
+  if (rxValues()) {
+#if PCA_HIST
+    histAdd(devPtr, mem2word(rfm69_buf+6));
+#endif
+    pcaHot.pState[devPtr-1]  = rfm69_buf[5];
+    pcaHot.pNow[devPtr-1]    = mem2word(rfm69_buf+6);
+    pcaHot.pTtl[devPtr-1]    = mem2word(rfm69_buf+8);
+    repUpdate(devPtr);
+    schedSet(devPtr, hal_millis() / 100 + jitter(30) + pcaConf.pollIntv);
+    pcaHot.retries[devPtr-1] = 0;
+    reqReply(devPtr, rfm69_buf[1]);
+    swReply(devPtr, rfm69_buf[5]);
   } else if (rfm69_buf[1] == 5) {
     // switch command, trigger poll
-    pcaConf.pcaDev[devPtr-1].nextTX  = millis() / 100 + 5;
+    schedSet(devPtr, hal_millis() / 100 + 5);
   }
 
   //- pairing request received? --------------------------------------------------------------------
   if (!rfm69_buf[0]) {
     if (!pcaConf.quiet) {
-      Serial.print("#PREQ ");
-      Serial.println(devId);
+      outStr("#PREQ ");
+      outDec(devId);
+      outLn();
     }
-    delay(70);                   // there's a timing issue while pairing, lose a bit of time
-    sendDevice(devPtr,'j');
-    cmd = 'j';
+    // there's a timing issue while pairing, answer after PCA_PAIR_DELAY and keep serving meanwhile
+    pairDev = devPtr;
+    pairDue = hal_millis() + PCA_PAIR_DELAY;
   }
 
-  //- save config to EEPROM ------------------------------------------------------------------------
-  if (confChanged)
-    saveConf();
-
 } // analyzePacket
 
+//- received frame carries state and power, it is no poll of a display unit or another gateway -----
+static byte rxValues() {
+  return mem2long(rfm69_buf+6) != 0xAAAAAAAA && mem2long(rfm69_buf+6) != 0xFFFFFFFF;
+}
+
+//- replies with values of known devices wait for change reports and store-and-forward -------------
+static byte repHold() {
+  return (repMode || safMode) && rfm69_crc == 0 && rfm69_buf[0] && rxValues() && getDevice(mem2devId(rfm69_buf+2));
+}
+
+//- values of the device were reported -------------------------------------------------------------
+static void repDone(uint8_t i) {
+  uint8_t bit = 1 << (i & 7);
+
+  if (repDue[i / 8] & bit) {
+    repDue[i / 8] &= ~bit;
+    repCnt--;
+  }
+  repKnown[i / 8] |= bit;
+  pcaHot.repNow[i]   = pcaHot.pNow[i];
+  pcaHot.repState[i] = pcaHot.pState[i];
+  pcaHot.repTs[i]    = hal_millis() / 1000;
+}
+
+//- new reply values: report on state change, a power step beyond both thresholds or heartbeat -----
+static void repUpdate(uint8_t devPtr) {
+  uint8_t i = devPtr - 1, bit = 1 << (i & 7);
+  uint16_t last = pcaHot.repNow[i], diff;
+
+  if (rxShown) {
+    repDone(i);                         // printed in full already
+    return;
+  }
+  if (repDue[i / 8] & bit) {
+    PCA_STAT(pcaStats.repCoalesced++);  // the waiting report takes the latest values
+    return;
+  }
+
+  // the deadband is the larger one of both thresholds
+  diff = (pcaHot.pNow[i] > last) ? pcaHot.pNow[i] - last : last - pcaHot.pNow[i];
+  if (!repMode || !(repKnown[i / 8] & bit) || pcaHot.pState[i] != pcaHot.repState[i]
+      || (diff > repAbs && (uint32_t)diff * 100 > (uint32_t)repRel * last)) {
+    // changed
+  } else if ((uint16_t)(hal_millis() / 1000 - pcaHot.repTs[i]) >= repBeat * 60) {
+    PCA_STAT(pcaStats.repBeats++);
+  } else {
+    PCA_STAT(pcaStats.repSuppressed++);
+    return;
+  }
+  repDue[i / 8] |= bit;
+  repCnt++;
+}
+
+//- print one waiting report once the output ring has room for it, devices take turns --------------
+static void repTask() {
+  if (!repCnt || (!safMode && (outJob || PCA_OUT_RING - outCnt < OUT_ROOM)))
+    return;                             // command replies go first
+
+  for (uint8_t n = 0; n < pcaConf.numDev; n++) {
+    uint8_t i = repNext;
+    repNext = (repNext + 1 < pcaConf.numDev) ? repNext + 1 : 0;
+    if (!(repDue[i / 8] & (1 << (i & 7))))
+      continue;
+
+    // as the poll reply with the latest values
+    uint8_t frame[PCA_PAYLOAD_LEN - 2] = {
+      pcaConf.pcaDev[i].channel, 4,
+      pcaConf.pcaDev[i].devId[0], pcaConf.pcaDev[i].devId[1], pcaConf.pcaDev[i].devId[2],
+      pcaHot.pState[i], (uint8_t)(pcaHot.pNow[i] >> 8), (uint8_t)pcaHot.pNow[i],
+      (uint8_t)(pcaHot.pTtl[i] >> 8), (uint8_t)pcaHot.pTtl[i]
+    };
+    repDone(i);
+#if PCA_SAF
+    if (safMode)
+      safAdd(i);
+    else
+#endif
+      showRX(0, frame);
+    PCA_STAT(pcaStats.repSent++);
+    return;
+  }
+
+  // devices erased meanwhile
+  memset(repDue, 0, sizeof repDue);
+  repCnt = 0;
+}
+
+#if PCA_SAF
+//- read the fields of the record at byte offset off from the oldest one, returns its length -------
+static uint8_t safRead(uint16_t off, uint32_t *v) {
+  uint8_t n = 0, c;
+
+  for (uint8_t f = 0; f < PCA_SAF_FIELDS; f++) {
+    v[f] = 0;
+    for (uint8_t shift = 0; ; shift += 7) {
+      c = safRing[(safTail + off + n++) & (PCA_SAF_BYTES - 1)];
+      v[f] |= (uint32_t)(c & 0x7f) << shift;
+      if (!(c & 0x80))
+        break;
+    }
+  }
+  return n;
+}
+
+//- remove the oldest record -----------------------------------------------------------------------
+static void safFree() {
+  uint32_t v[PCA_SAF_FIELDS];
+  uint8_t n = safRead(0, v);
+
+  if (safSend) {
+    safSend--;
+    safSendOff -= n;
+  }
+  safTail = (safTail + n) & (PCA_SAF_BYTES - 1);
+  safLen -= n;
+  safCnt--;
+  safSeq++;
+
+  // the time step of the new oldest record referred to the removed one
+  if (safCnt) {
+    safRead(0, v);
+    safTs += v[0];
+  }
+}
+
+//- queue the reported values of a device, the oldest readings give way ----------------------------
+static void safAdd(uint8_t i) {
+  uint32_t now = hal_millis() / 1000;
+  uint32_t v[PCA_SAF_FIELDS] = {
+    safCnt ? now - safHeadTs : 0, devIdOf(i + 1) << 1 | (pcaHot.pState[i] & 1),
+    pcaConf.pcaDev[i].channel, pcaHot.pNow[i], pcaHot.pTtl[i]
+  };
+  uint8_t rec[PCA_SAF_FIELDS * 5], n = 0;
+
+  for (uint8_t f = 0; f < PCA_SAF_FIELDS; f++) {
+    do {
+      rec[n++] = (v[f] & 0x7f) | ((v[f] > 0x7f) ? 0x80 : 0);
+      v[f] >>= 7;
+    } while (v[f]);
+  }
+
+  while (safLen + n > PCA_SAF_BYTES) {
+    if (!safSend) {
+      if (!safLost++)
+        safLostSeq = safSeq;
+      PCA_STAT(pcaStats.safLost++);
+    }
+    PCA_STAT(pcaStats.safDropped++);
+    safFree();
+  }
+
+  if (!safCnt)
+    safTs = now;
+  for (uint8_t k = 0; k < n; k++)
+    safRing[(safTail + safLen + k) & (PCA_SAF_BYTES - 1)] = rec[k];
+  safLen += n;
+  safCnt++;
+  safHeadTs = now;
+  PCA_STAT(pcaStats.safStored++);
+}
+
+//- readings up to seq arrived, replay the following ones if asked ---------------------------------
+static void safAck(uint16_t seq, uint8_t replay) {
+  // records never printed are kept, whatever the host claims
+  while (safSend && (int16_t)(seq - safSeq) >= 0)
+    safFree();
+
+  if (replay) {
+    uint16_t gap = safSeq - (uint16_t)(seq + 1);
+    if (gap && gap < 0x8000) {          // dropped meanwhile
+      safLost = gap;
+      safLostSeq = seq + 1;
+    }
+    safSend = 0;
+    safSendOff = 0;
+  }
+}
+
+//- print the next stored reading once the output ring has room for it -----------------------------
+static void safTask() {
+  if (!safMode || outJob || PCA_OUT_RING - outCnt < OUT_ROOM)
+    return;                             // command replies go first
+
+  if (safLost) {
+    if (outBin) {
+      uint8_t rec[PCA_BIN_LOST_LEN] = {
+        (uint8_t)(safLostSeq >> 8), (uint8_t)safLostSeq, (uint8_t)(safLost >> 8), (uint8_t)safLost
+      };
+      outRec(PCA_BIN_LOST, rec, sizeof rec);
+    } else {
+      outStr("#LOST ");
+      outDec(safLostSeq);
+      outChar(' ');
+      outDec(safLost);
+      outLn();
+    }
+    safLost = 0;
+    return;
+  }
+
+  if (safSend >= safCnt)
+    return;
+
+  uint32_t v[PCA_SAF_FIELDS];
+  uint8_t n = safRead(safSendOff, v);
+  uint32_t ts = safSend ? safSendTs + v[0] : safTs;
+  uint32_t age = hal_millis() / 1000 - ts;
+  uint16_t seq = safSeq + safSend;
+  uint8_t rec[PCA_BIN_SAF_LEN] = {
+    (uint8_t)(seq >> 8), (uint8_t)seq, (uint8_t)(age >> 8), (uint8_t)age,
+    (uint8_t)v[2], 4, (uint8_t)(v[1] >> 17), (uint8_t)(v[1] >> 9), (uint8_t)(v[1] >> 1),
+    (uint8_t)(v[1] & 1), (uint8_t)(v[3] >> 8), (uint8_t)v[3], (uint8_t)(v[4] >> 8), (uint8_t)v[4]
+  };
+
+  if (age > 0xffff)
+    rec[2] = rec[3] = 0xff;
+
+  if (outBin) {
+    outRec(PCA_BIN_SAF, rec, sizeof rec);
+  } else {
+    // the OK line of the reading, preceded by its sequence number and age
+    outStr("F ");
+    outDec(seq);
+    outChar(' ');
+    outDec(age > 0xffff ? 0xffff : age);
+    outStr(" OK ");
+    outDec(NODEID);
+    for (uint8_t k = 4; k < sizeof rec; k++) {
+      outChar(' ');
+      showByte(rec[k]);
+    }
+    outLn();
+  }
+
+  safSend++;
+  safSendOff += n;
+  safSendTs = ts;
+  PCA_STAT(pcaStats.safSent++);
+}
+#endif
+
+#if PCA_HIST
+//- apply the zigzag varint delta at p to value, returns its length --------------------------------
+static uint8_t histDelta(const uint8_t *p, uint16_t *value) {
+  uint32_t z = 0;
+  uint8_t n = 0;
+
+  do {
+    z |= (uint32_t)(p[n] & 0x7f) << (7 * n);
+  } while (p[n++] & 0x80);
+  *value += (z & 1) ? ~(z >> 1) : z >> 1;
+  return n;
+}
+
+//- add pNow sample, called before pcaHot.pNow takes the new value ---------------------------------
+static void histAdd(uint8_t devPtr, uint16_t value) {
+  struct_pcaHist *h = &pcaHist[devPtr-1];
+  int32_t d = (int32_t)value - pcaHot.pNow[devPtr-1];
+  uint32_t z = ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+  uint8_t buf[3], n = 0;
+
+  // window aggregates, a full window stops counting
+  if (h->cnt < 0xffff) {
+    if (!h->cnt || value < h->min)
+      h->min = value;
+    if (!h->cnt || value > h->max)
+      h->max = value;
+    h->sum += value;
+    h->cnt++;
+  }
+
+  if (!h->samples) {
+    h->oldest = value;
+    h->samples = 1;
+    return;
+  }
+
+  do {
+    buf[n++] = (z & 0x7f) | ((z > 0x7f) ? 0x80 : 0);
+    z >>= 7;
+  } while (z);
+
+  // the oldest samples make room
+  while (h->len + n > PCA_HIST_BYTES) {
+    uint8_t k = histDelta(h->delta, &h->oldest);
+    h->len -= k;
+    memmove(h->delta, h->delta + k, h->len);
+    h->samples--;
+  }
+  memcpy(h->delta + h->len, buf, n);
+  h->len += n;
+  h->samples++;
+}
+#endif
+
+//- device index hash: fold the 24 bit devId into a slot -------------------------------------------
+static uint16_t devIdxHash(uint32_t devId) {
+  return ((uint16_t)devId ^ (uint16_t)(devId >> 8) ^ (uint8_t)(devId >> 16)) & (DEVIDX_SIZE - 1);
+}
+
+//- add device to index ----------------------------------------------------------------------------
+static void devIdxAdd(uint8_t devPtr) {
+  uint16_t pos = devIdxHash(devIdOf(devPtr));
+  while (devIdx[pos])
+    pos = (pos + 1) & (DEVIDX_SIZE - 1);
+  devIdx[pos] = devPtr;
+}
+
+//- rebuild index from pcaConf ---------------------------------------------------------------------
+static void devIdxBuild() {
+  memset(devIdx, 0, sizeof devIdx);
+  if (pcaConf.numDev > PCA_MAXDEV)
+    pcaConf.numDev = PCA_MAXDEV;        // never trust a count beyond the table
+  for (uint8_t i = 1; i <= pcaConf.numDev; i++)
+    if (devUsed(i))
+      devIdxAdd(i);
+}
+
+//- place device at heap position ------------------------------------------------------------------
+static void schedPlace(uint8_t pos, uint8_t devPtr) {
+  schedHeap[pos] = devPtr;
+  schedPos[devPtr-1] = pos + 1;
+}
+
+//- move heap entry up or down until its nextTX is in order ----------------------------------------
+static void schedSift(uint8_t pos) {
+  uint8_t devPtr = schedHeap[pos];
+  uint32_t key = pcaHot.nextTX[devPtr-1];
+
+  while (pos) {
+    uint8_t parent = (pos - 1) / 2;
+    if (pcaHot.nextTX[schedHeap[parent]-1] <= key)
+      break;
+    schedPlace(pos, schedHeap[parent]);
+    pos = parent;
+  }
+
+  for (;;) {
+    uint16_t child = 2 * pos + 1;
+    if (child >= schedCnt)
+      break;
+    if (child + 1 < schedCnt && pcaHot.nextTX[schedHeap[child+1]-1] < pcaHot.nextTX[schedHeap[child]-1])
+      child++;
+    if (pcaHot.nextTX[schedHeap[child]-1] >= key)
+      break;
+    schedPlace(pos, schedHeap[child]);
+    pos = child;
+  }
+
+  schedPlace(pos, devPtr);
+}
+
+//- set next poll time of a device and queue it ----------------------------------------------------
+static void schedSet(uint8_t devPtr, uint32_t nextTX) {
+  pcaHot.nextTX[devPtr-1] = nextTX;
+  if (!schedPos[devPtr-1])
+    schedPlace(schedCnt++, devPtr);
+  schedSift(schedPos[devPtr-1] - 1);
+}
+
+//- rebuild scheduler from pcaConf -----------------------------------------------------------------
+static void schedBuild() {
+  schedCnt = 0;
+  memset(schedPos, 0, sizeof schedPos);
+  for (uint8_t i = 1; i <= pcaConf.numDev; i++)
+    if (devUsed(i))
+      schedSet(i, pcaHot.nextTX[i-1]);
+}
+
+//- random value 0..range-1: xorshift16 scaled by multiply, avoids 32 bit random() and modulo ------
+static uint8_t jitter(uint8_t range) {
+  rndState ^= rndState << 7;
+  rndState ^= rndState >> 9;
+  rndState ^= rndState << 8;
+  return ((uint16_t)(uint8_t)rndState * range) >> 8;
+}
+
+//- reply timeout of a device in ms, devPtr 0 for any device ---------------------------------------
+static uint16_t reqTimeout(uint8_t devPtr) {
+  uint16_t rtt = (devPtr && devRtt[devPtr-1]) ? devRtt[devPtr-1] : rttAvg;
+  return constrain(4 * rtt, PCA_TIMEOUT_MIN, PCA_TIMEOUT_MAX);
+}
+
+//- track request, returns entry + 1 or 0 if the table is full -------------------------------------
+static uint8_t reqAdd(uint8_t devPtr, uint8_t cmd) {
+  uint8_t free = 0;
+  for (uint8_t i = 0; i < PCA_MAXREQ; i++) {
+    if (reqTab[i].devPtr == devPtr && reqTab[i].cmd == cmd) {
+      reqTab[i].sent = 0;               // repeated request, restart timeout
+      return i + 1;
+    }
+    if (!reqTab[i].devPtr && !free)
+      free = i + 1;
+  }
+  if (free) {
+    reqTab[free-1] = (struct_pcaReq){devPtr, cmd, 0, 0};
+    reqCnt++;
+    pcaStats.requests++;
+  }
+  return free;
+}
+
+//- match reply to request and update RTT ----------------------------------------------------------
+static void reqReply(uint8_t devPtr, uint8_t cmd) {
+  for (uint8_t i = 0; i < PCA_MAXREQ; i++) {
+    struct_pcaReq *req = &reqTab[i];
+    if (req->devPtr != devPtr || req->cmd != cmd || !req->sent || (long)(rxTs - req->ts) < 0)
+      continue;
+
+    uint16_t rtt = rxTs - req->ts;
+    devRtt[devPtr-1] = devRtt[devPtr-1] ? (3 * devRtt[devPtr-1] + rtt) / 4 : rtt;
+    rttAvg = (3 * rttAvg + rtt) / 4;
+    pcaStats.replies++;
+#if PCA_STATS
+    pcaStats.rttSum += rtt;
+    if (rtt > pcaStats.rttMax)
+      pcaStats.rttMax = rtt;
+#endif
+
+    if (replyWaitDev == devPtr)
+      replyWaitDev = 0;
+    req->devPtr = 0;
+    reqCnt--;
+    return;
+  }
+}
+
+//- channel kept free while the last request is on air or may still be answered --------------------
+static bool replyWait(unsigned long now) {
+  return reqTx || (replyWaitDev && (long)(now - replyWaitUntil) < 0);
+}
+
+//- expire unanswered requests, retry soon or mark device dead -------------------------------------
+static void reqCheck() {
+  if (!reqCnt)
+    return;
+
+  unsigned long now = hal_millis();
+  for (uint8_t i = 0; i < PCA_MAXREQ; i++) {
+    struct_pcaReq *req = &reqTab[i];
+    if (!req->devPtr || !req->sent || now - req->ts < reqTimeout(req->devPtr))
+      continue;
+
+    uint8_t *retries = &pcaHot.retries[req->devPtr-1];
+    if (*retries < 255)
+      *retries += 1;
+    if (*retries < PCA_MAXRETRIES)
+      schedSet(req->devPtr, now / 100 + jitter(5) + 2);
+    else
+      schedSet(req->devPtr, now / 100 + jitter(30) + pcaConf.deadIntv);
+
+    pcaStats.timeouts++;
+    if (replyWaitDev == req->devPtr)
+      replyWaitDev = 0;
+    req->devPtr = 0;
+    reqCnt--;
+  }
+}
+
+//- switch retransmission delay: reply timeout doubled per attempt, jittered against collisions ----
+static unsigned long swBackoff(uint8_t devPtr, uint8_t tries) {
+  return ((unsigned long)reqTimeout(devPtr) << (tries - 1)) + jitter(50);
+}
+
+//- bitmaps of devices or EEPROM slots -------------------------------------------------------------
+static bool mapGet(const uint8_t *map, uint16_t bit) {
+  return map[bit >> 3] & (1 << (bit & 7));
+}
+
+static void mapSet(uint8_t *map, uint16_t bit) {
+  map[bit >> 3] |= 1 << (bit & 7);
+}
+
+static void mapClr(uint8_t *map, uint16_t bit) {
+  map[bit >> 3] &= ~(1 << (bit & 7));
+}
+
+//- group member pending? --------------------------------------------------------------------------
+static bool grpMember(uint8_t devPtr) {
+  return mapGet(grpPend, devPtr - 1);
+}
+
+//- report group result ----------------------------------------------------------------------------
+static void grpReport(const char *result, uint16_t ms) {
+  outStr("#GROUP ");
+  outStr(result);
+  outChar(' ');
+  outDec(grpState);
+  outChar(' ');
+  outDec(grpOk);
+  outChar(' ');
+  outDec(grpCnt);
+  outChar(' ');
+  outDec(grpTries);
+  outChar(' ');
+  outDec(ms);
+  outLn();
+
+#if PCA_STATS
+  if (grpOk == grpCnt) {
+    pcaStats.grpOk++;
+    if (ms > pcaStats.grpTimeMax)
+      pcaStats.grpTimeMax = ms;
+  } else if (swConfirm)
+    pcaStats.grpFailed++;               // unconfirmed groups are only sent
+#endif
+  grpCnt = 0;
+}
+
+//- group done once every remaining member confirmed -----------------------------------------------
+static void grpDone(unsigned long ts) {
+  if (grpOk == grpCnt)
+    grpReport("ok", ts - grpStart);
+}
+
+//- switch the devices set in mask, a new group replaces a running one -----------------------------
+static void grpAdd(const uint8_t *mask, uint8_t len, uint8_t state) {
+  unsigned long now = hal_millis();
+  uint8_t devPtr;
+
+  // a mask without known devices is rejected, a running group goes on
+  for (devPtr = 1; devPtr <= pcaConf.numDev && (devPtr - 1) >> 3 < len; devPtr++)
+    if (mapGet(mask, devPtr - 1) && devUsed(devPtr))
+      break;
+  if (devPtr > pcaConf.numDev || (devPtr - 1) >> 3 >= len) {
+    outStr("#GROUP empty");
+    outLn();
+    return;
+  }
+
+  if (grpCnt)
+    grpReport("failed", now - grpStart);
+
+  memset(grpPend, 0, sizeof grpPend);
+  grpOk = 0;
+  for (; devPtr <= pcaConf.numDev && (devPtr - 1) >> 3 < len; devPtr++) {
+    if (mapGet(mask, devPtr - 1) && devUsed(devPtr)) {
+      swDrop(devPtr);                   // the group wins over a single command
+      mapSet(grpPend, devPtr - 1);
+      grpCnt++;
+    }
+  }
+  grpState = state;
+  grpTries = 1;
+  grpNext  = 1;
+  grpStart = now;
+  grpDue   = 0;
+}
+
+//- take device out of the group -------------------------------------------------------------------
+static void grpDrop(uint8_t devPtr) {
+  if (grpCnt && grpMember(devPtr)) {
+    mapClr(grpPend, devPtr - 1);
+    grpCnt--;
+    grpDone(hal_millis());
+  }
+}
+
+//- reply carrying the desired state confirms a group member ---------------------------------------
+static void grpReply(uint8_t devPtr, uint8_t state) {
+  if (!grpCnt || !grpMember(devPtr) || state != grpState || (long)(rxTs - grpStart) < 0)
+    return;
+
+  mapClr(grpPend, devPtr - 1);
+  grpOk++;
+  grpDone(rxTs);
+}
+
+//- send the group: first round back-to-back, later rounds leave room for each reply ---------------
+static void grpTask() {
+  if (!grpCnt)
+    return;
+
+  unsigned long now = hal_millis();
+
+  while (grpNext <= pcaConf.numDev) {
+    if (txqCnt >= PCA_TXQ_LEN - 1)
+      return;                           // keep a slot for interactive commands
+    if (grpTries > 1 && (txqCnt || replyWait(now)))
+      return;
+    uint8_t devPtr = grpNext++;
+    if (grpMember(devPtr))
+      sendDevice(devPtr, grpState ? 'e' : 'd');
+  }
+
+  // round done once its last frame left the radio and the replies had time to arrive
+  if (!grpDue) {
+    if ((txqCnt && txq[0].prio == PCA_TX_SWITCH) || rfm69_send_busy(pca301_rfm69_tx))
+      return;
+    grpDue = now + reqTimeout(0);
+    return;
+  }
+  if ((long)(now - grpDue) < 0)
+    return;
+
+  if (!swConfirm) {
+    grpReport("sent", now - grpStart);  // unconfirmed, one round only
+    return;
+  }
+  if (grpTries >= PCA_SW_TRIES) {
+    grpReport("failed", now - grpStart);
+    return;
+  }
+  grpTries++;
+  grpNext = 1;
+  grpDue  = 0;
+}
+
+//- confirm switch command, a newer one for the same device replaces it ----------------------------
+static void swAdd(uint8_t devPtr, uint8_t state) {
+  struct_pcaSw *sw = NULL;
+
+  if (!devUsed(devPtr))
+    return;
+  grpDrop(devPtr);                      // the single command wins over the group
+  if (!swConfirm)
+    return;
+
+  for (uint8_t i = 0; i < PCA_MAXSW; i++) {
+    if (swTab[i].devPtr == devPtr) {
+      sw = &swTab[i];
+      break;
+    }
+    if (!swTab[i].devPtr && !sw)
+      sw = &swTab[i];
+  }
+  if (!sw)
+    return;                             // table full, send unconfirmed
+  if (!sw->devPtr)
+    swCnt++;
+
+  unsigned long now = hal_millis();
+  *sw = (struct_pcaSw){devPtr, state, 1, now, now + swBackoff(devPtr, 1)};
+}
+
+//- report switch result ---------------------------------------------------------------------------
+static void swReport(struct_pcaSw *sw, const char *result, uint16_t ms) {
+  // the result lines are opt-in, the default output stays as it was before
+  if (swConfirm > 1) {
+    outStr("#SWITCH ");
+    outStr(result);
+    outChar(' ');
+    outDec(sw->devPtr);
+    outChar(' ');
+    outDec(sw->state);
+    outChar(' ');
+    outDec(sw->tries);
+    outChar(' ');
+    outDec(ms);
+    outLn();
+  }
+
+  PCA_STAT(pcaStats.swTries += sw->tries);
+  sw->devPtr = 0;
+  swCnt--;
+}
+
+//- forget pending switch command of a device ------------------------------------------------------
+static void swDrop(uint8_t devPtr) {
+  for (uint8_t i = 0; swCnt && i < PCA_MAXSW; i++) {
+    if (swTab[i].devPtr == devPtr) {
+      swTab[i].devPtr = 0;
+      swCnt--;
+    }
+  }
+}
+
+//- any reply carrying the desired state confirms the switch command -------------------------------
+static void swReply(uint8_t devPtr, uint8_t state) {
+  grpReply(devPtr, state);
+  if (!swCnt)
+    return;
+
+  for (uint8_t i = 0; i < PCA_MAXSW; i++) {
+    struct_pcaSw *sw = &swTab[i];
+    if (sw->devPtr != devPtr || sw->state != state || (long)(rxTs - sw->start) < 0)
+      continue;
+
+    uint16_t ms = rxTs - sw->start;
+    pcaStats.swOk++;
+#if PCA_STATS
+    pcaStats.swTimeSum += ms;
+    if (ms > pcaStats.swTimeMax)
+      pcaStats.swTimeMax = ms;
+#endif
+    swReport(sw, "ok", ms);
+    return;
+  }
+}
+
+//- retransmit unconfirmed switch commands, give up after PCA_SW_TRIES -----------------------------
+static void swCheck() {
+  if (!swCnt)
+    return;
+
+  unsigned long now = hal_millis();
+  for (uint8_t i = 0; i < PCA_MAXSW; i++) {
+    struct_pcaSw *sw = &swTab[i];
+    if (!sw->devPtr || (long)(now - sw->due) < 0)
+      continue;
+
+    if (sw->tries >= PCA_SW_TRIES) {
+      pcaStats.swFailed++;
+      swReport(sw, "failed", now - sw->start);
+      continue;
+    }
+
+    sw->tries++;
+    sw->due = now + swBackoff(sw->devPtr, sw->tries);
+    sendDevice(sw->devPtr, sw->state ? 'e' : 'd');
+  }
+}
+
+//- request statistics -----------------------------------------------------------------------------
+const struct struct_pcaStats *pca301serial_stats() {
+  return &pcaStats;
+}
+
 //- lookup device ----------------------------------------------------------------------------------
 static uint8_t getDevice(uint32_t devId) {
-  for (int i = 0; i < pcaConf.numDev; i++) {
-    if (pcaConf.pcaDev[i].devId == devId)
-      return(i+1);    // device found
+  uint16_t pos = devIdxHash(devId);
+  uint8_t devPtr;
+  PCA_STAT(pcaStats.devLookups++);
+  while ((devPtr = devIdx[pos])) {
+    PCA_STAT(pcaStats.devCompares++);
+    if (devIdOf(devPtr) == devId)
+      return devPtr;    // device found
+    pos = (pos + 1) & (DEVIDX_SIZE - 1);
   }
   return 0;
 }
@@ -286,6 +1369,39 @@ static uint32_t mem2devId(volatile uint8_t * data) {
   return (uint32_t)data[0] << 16 | (uint32_t)data[1] << 8 | (uint32_t)data[2];
 }
 
+//- packed 24 bit devId of a configured device -----------------------------------------------------
+static uint32_t devIdOf(uint8_t devPtr) {
+  return mem2devId(pcaConf.pcaDev[devPtr-1].devId);
+}
+
+static void devIdSet(uint8_t devPtr, uint32_t devId) {
+  pcaConf.pcaDev[devPtr-1].devId[0] = devId >> 16;
+  pcaConf.pcaDev[devPtr-1].devId[1] = devId >> 8;
+  pcaConf.pcaDev[devPtr-1].devId[2] = devId;
+}
+
+//- device number in use, devices lost from EEPROM leave a free entry ------------------------------
+static byte devUsed(uint8_t devPtr) {
+  return devPtr >= 1 && devPtr <= pcaConf.numDev && devIdOf(devPtr);
+}
+
+//- first free device number, 0 if the table is full -----------------------------------------------
+static uint8_t devFree() {
+  for (uint8_t devPtr = 1; devPtr <= pcaConf.numDev; devPtr++)
+    if (!devIdOf(devPtr))
+      return devPtr;
+  return (pcaConf.numDev < PCA_MAXDEV) ? ++pcaConf.numDev : 0;
+}
+
+//- store 32 bit value, most significant byte first ------------------------------------------------
+static uint8_t *putLong(uint8_t *p, uint32_t value) {
+  p[0] = value >> 24;
+  p[1] = value >> 16;
+  p[2] = value >> 8;
+  p[3] = value;
+  return p + 4;
+}
+
 //- mem2word ---------------------------------------------------------------------------------------
 static uint16_t mem2word(volatile uint8_t * data) {
   return data[0] << 8 | data[1];
@@ -299,22 +1415,162 @@ static uint32_t mem2long(volatile uint8_t * data) {
 //- turn activityLed on/off ------------------------------------------------------------------------
 static void activityLed (byte on) {
   #ifdef LED_PIN
-    pinMode(LED_PIN, OUTPUT);
-    digitalWrite(LED_PIN, !on);
+    hal_gpio_output(LED_PIN);
+    hal_gpio_write(LED_PIN, !on);
   #endif
 }
 
-//- showNibble -------------------------------------------------------------------------------------
-static void showNibble (byte nibble) {
-  char c = '0' + (nibble & 0x0F);
-  if (c > '9')
-    c += 7;
-  Serial.print(c);
-}
-
 //- showByte ---------------------------------------------------------------------------------------
 static void showByte (byte value) {
-  Serial.print(value);
+  outDec(value);
+}
+
+//- serial output: lines are built in outBuf, queued whole in outRing and written by outTask() -----
+static_assert((PCA_OUT_RING & (PCA_OUT_RING - 1)) == 0, "PCA_OUT_RING must be a power of 2");
+
+static char outPop() {
+  char c = outRing[outHead];
+  outHead = (outHead + 1) & (PCA_OUT_RING - 1);
+  outCnt--;
+  return c;
+}
+
+// newest queued line equals outBuf and was not started on the UART yet
+static byte outSame(const char *buf, uint8_t len) {
+  if (len != outLastLen || outCnt < len)
+    return 0;
+  for (uint8_t i = 0; i < len; i++)
+    if (outRing[(outHead + outCnt - len + i) & (PCA_OUT_RING - 1)] != buf[i])
+      return 0;
+  return 1;
+}
+
+static void outQueue(const char *buf, uint8_t len) {
+  if (outCnt + len > PCA_OUT_RING) {
+    if (outSame(buf, len))
+      pcaStats.outCoalesced++;
+    else
+      pcaStats.outDropped++;
+    return;
+  }
+
+  for (uint8_t i = 0; i < len; i++)
+    outRing[(outHead + outCnt + i) & (PCA_OUT_RING - 1)] = buf[i];
+  outCnt += len;
+  outLastLen = len;
+#if PCA_STATS
+  pcaStats.outLines++;
+  if (outCnt > pcaStats.outMax)
+    pcaStats.outMax = outCnt;
+#endif
+}
+
+//- binary record: type, timestamp, payload and crc16, COBS encoded and terminated by 0 ------------
+static void outRec(uint8_t type, const uint8_t *data, uint8_t len) {
+  uint8_t rec[PCA_BIN_MAX + 9];
+  unsigned long ts = hal_millis();
+  uint8_t n = 0, code = 0;
+  uint16_t crc;
+
+  if (len > PCA_BIN_MAX)
+    len = PCA_BIN_MAX;
+
+  // raw record from rec[1] on, encoded in place: every 0 becomes the distance to the next one
+  rec[++n] = type;
+  rec[++n] = ts >> 24;
+  rec[++n] = ts >> 16;
+  rec[++n] = ts >> 8;
+  rec[++n] = ts;
+  memcpy(rec + n + 1, data, len);
+  n += len;
+  crc = crc16_pca301(rec + 1, n);
+  rec[++n] = crc >> 8;
+  rec[++n] = crc;
+
+  for (uint8_t i = 1; i <= n; i++) {
+    if (!rec[i]) {
+      rec[code] = i - code;
+      code = i;
+    }
+  }
+  rec[code] = n + 1 - code;
+  rec[n + 1] = 0;
+
+  outQueue((const char *)rec, n + 2);
+}
+
+static void outPush() {
+  if (!outLen)
+    return;
+  if (outBin)
+    outRec(PCA_BIN_TEXT, (const uint8_t *)outBuf, outLen);
+  else
+    outQueue(outBuf, outLen);
+  outLen = 0;
+}
+
+static void outChar(char c) {
+  if (outLen == PCA_OUT_LINE)
+    outPush();                          // overlong lines are queued in parts
+  outBuf[outLen++] = c;
+}
+
+static void outStr(const char *s) {
+  while (*s)
+    outChar(*s++);
+}
+
+// packed BCD of 0..99, two digits per lookup instead of divisions
+static const uint8_t outBcd[100] PROGMEM = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+  0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19,
+  0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29,
+  0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39,
+  0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+  0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+  0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+  0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79,
+  0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+  0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99
+};
+
+static void outDec(uint32_t value) {
+  char buf[10];
+  uint8_t n = 0;
+  uint8_t bcd;
+
+  if (value > 255) {
+    do {
+      buf[n++] = '0' + value % 10;
+      value /= 10;
+    } while (value);
+    while (n)
+      outChar(buf[--n]);
+    return;
+  }
+
+  if (value >= 100) {
+    outChar((value >= 200) ? '2' : '1');
+    bcd = pgm_read_byte(&outBcd[value - ((value >= 200) ? 200 : 100)]);
+    outChar('0' + (bcd >> 4));
+  } else {
+    bcd = pgm_read_byte(&outBcd[value]);
+    if (bcd >> 4)
+      outChar('0' + (bcd >> 4));
+  }
+  outChar('0' + (bcd & 0x0f));
+}
+
+static void outLn() {
+  outChar('\r');
+  outChar('\n');
+  outPush();
+}
+
+// hand queued bytes to the UART as far as it takes them without blocking
+static void outTask() {
+  for (int n = hal_serial_tx_free(); n > 0 && outCnt; n--)
+    hal_serial_print_char(outPop());
 }
 
 //- helpText ---------------------------------------------------------------------------------------
@@ -324,46 +1580,90 @@ const char helpText1[] PROGMEM =
   "     ..,.. s    - send data packet" "\n"
   "           l    - list devices" "\n"
   "       <n> a    - turn activity LED on PB1 on or off" "\n"
+  "       <n> b    - binary output (1=COBS framed records)" "\n"
   "       <n> c    - config (0=fill, 1=load, 2=save, 3=erase)" "\n"
   "       <n> d    - turn off device <n>" "\n"
   "       <n> e    - turn on device <n>" "\n"
+#if PCA_SAF
+  "       <n> f    - store-and-forward (1=readings as F lines with sequence numbers)" "\n"
+  "   h,l,<n> g    - acknowledge F lines up to h*256+l (1=print the following again)" "\n"
+#endif
+  "     ..,.. d/e  - turn off/on devices by bitmask, first byte = devices 1-8" "\n"
   "  0x<hhhh> h    - set center frequency offset (Example: 0x03B6 => 868.950MHz)" "\n"
   "                  note: leading zeros must be entered" "\n"
+  "       <n> k    - confirmed switching (1=retransmit until acked, 2=print #SWITCH too)" "\n"
   "       <n> p    - poll device <n>" "\n"
   "       <n> r    - list recordings" "\n"
   "       <n> q    - quiet mode (1=suppress TX and bad packets)" "\n"
+  "       <n> u    - change-driven reports (1=only changed values and heartbeats)" "\n"
+  " a,r,m,<n> u    - same with pNow thresholds a and r (%), heartbeat m minutes" "\n"
   "       <n> v    - version and configuration report" "\n"
+#if PCA_HIST
+  "       <n> w    - power statistics (1=start a new window)" "\n"
+#endif
 ;
 
-//- showString -------------------------------------------------------------------------------------
-static void showString (PGM_P s) {
+//- showLine: print a line of a PROGMEM text, returns the next one or NULL at the end --------------
+static PGM_P showLine (PGM_P s) {
   for (;;) {
     char c = pgm_read_byte(s++);
     if (c == 0)
-      break;
-    if (c == '\n')
-      Serial.print('\r');
-    Serial.print(c);
+      return NULL;
+    if (c == '\n') {
+      outLn();
+      return s;
+    }
+    outChar(c);
   }
 }
 
 //- showHelp ---------------------------------------------------------------------------------------
 static void showHelp () {
-  Serial.print("\n[");
-  Serial.print(PROGNAME);
-  Serial.print('.');
-  Serial.print(PROGVERS);
-  Serial.println(']');
-  showString(helpText1);
-  Serial.println();
+  outStr("\n[");
+  outStr(PROGNAME);
+  outChar('.');
+  outStr(PROGVERS);
+  outChar(']');
+  outLn();
+  outJob = OUT_JOB_HELP;               // the text follows a line per loop
+  outJobText = helpText1;
 }
 
-//- handleInput ------------------------------------------------------------------------------------
-static void handleInput (char c) {
-  if (freq.startsWith("0x") && c != 'h') {
-    if (('A' <= c && c <='F') || ('0' <= c && c <= '9')) {
-      freq += c;
+//- print the next line of a long command reply once the output ring has room for it ---------------
+static void outJobTask() {
+  if (!outJob || PCA_OUT_RING - outCnt < OUT_JOB_ROOM)
+    return;
+
+  if (outJob == OUT_JOB_HELP) {
+    outJobText = showLine(outJobText);
+    if (!outJobText) {
+      outLn();
+      outJob = 0;
     }
+    return;
+  }
+
+  // devices lost from EEPROM are skipped
+  while (outJobDev < pcaConf.numDev && !devUsed(outJobDev + 1))
+    outJobDev++;
+  if (outJobDev >= pcaConf.numDev) {
+    outJob = 0;
+    return;
+  }
+#if PCA_HIST
+  if (outJob == OUT_JOB_HIST || outJob == OUT_JOB_HIST_NEW)
+    reportHistDev(outJobDev, outJob == OUT_JOB_HIST_NEW);
+  else
+#endif
+    reportDev((outJob == OUT_JOB_LIST) ? 1 : 2, outJobDev);
+  outJobDev++;
+}
+
+//- handleInput: one byte of the command stream, all state lives in fixed variables ----------------
+static void handleInput (char c) {
+  if (freqMode && c != 'h') {
+    if (hexDigit(c) >= 0)
+      freqHex = (freqHex << 4) | hexDigit(c);   // the last 4 digits count
   } else if ('0' <= c && c <= '9') {
     value = 10 * value + c - '0';
   } else if (c == ',') {
@@ -371,9 +1671,11 @@ static void handleInput (char c) {
       stack[top++] = value;
     value = 0;
   } else if (c == 'x') {
-    freq = String("0x");
+    freqMode = 1;
+    freqHex = 0;
     value = 0;
   } else if ('a' <= c && c <='w') {      
+      PCA_STAT(pcaStats.cmds++);
       switch (c) {
         default:
           showHelp();
@@ -381,9 +1683,36 @@ static void handleInput (char c) {
         case 'a':     // turn activity LED on or off
           activityLed(value);
           break;
+        case 'b':     // switch between text and binary output
+          if (value && !outBin)
+            outQueue("", 1);    // delimiter, text printed so far is not taken for a record
+          outBin = value;
+          break;
         case 'l':     // list known devices
           reportConf(1);
           break;
+        case 'u':     // change-driven reports, optionally preceded by thresholds and heartbeat
+          if (top == 3) {
+            repAbs  = stack[0];
+            repRel  = stack[1];
+            repBeat = stack[2];
+          }
+          repMode = value;
+          break;
+#if PCA_SAF
+        case 'f':     // store-and-forward of readings
+          safMode = value;
+          break;
+        case 'g':     // acknowledge stored readings up to a sequence number
+          if (top == 2)
+            safAck(stack[0] << 8 | stack[1], value);
+          break;
+#endif
+#if PCA_HIST
+        case 'w':     // power statistics
+          reportHist(value);
+          break;
+#endif
         case 'q':     // turn quiet mode on or off (don't report TX and bad packets)
           pcaConf.quiet = value;
           break;
@@ -391,97 +1720,104 @@ static void handleInput (char c) {
           reportConf(2);
           break;
         case 's':     // send packet
-          if (top < sizeof stack) {
+          if (top < PCA_TXQ_DATA) {
             stack[top++] = value;
-            sendLen      = top;
-            cmd          = c;
-            memcpy(pBuf, stack, top);
-            if (sendLen == 10 && pBuf[1] == 5)
-              setNextTX(mem2devId(pBuf+2), 10);
-            if (!pcaConf.quiet) {
-              Serial.print("TX ");
-              Serial.print(NODEID);
-              for (byte i = 0; i < sendLen; i++) {
-                Serial.print(' ');
-                showByte(pBuf[i]);
-              }
-              Serial.println();
+            uint8_t devPtr = (top == PCA_TXQ_DATA) ? getDevice(mem2devId(stack+2)) : 0;
+            if (devPtr && stack[1] == 5) {
+              setNextTX(mem2devId(stack+2), 10);
+              swAdd(devPtr, stack[5]);
             }
+            if (txqAdd(PCA_TX_SWITCH, devPtr, stack, top))
+              showTX(stack, top);
           } else
             top = 0;
           break;
         case 'v':     // report version and configuration parameters
           displayVersion(1);
+          if (outBin)
+            reportStats();
           break;
         case 'd':     // turn a device off (disable)
         case 'e':     // turn a device on (enable)
+          if (top) {  // bitmask of devices, longer masks than devices are rejected
+            if (top < (PCA_MAXDEV + 7) / 8 && top < sizeof stack) {
+              stack[top++] = value;
+              grpAdd(stack, top, c == 'e');
+            } else {
+              outStr("#GROUP invalid");
+              outLn();
+            }
+            break;
+          }
+          swAdd(value, c == 'e');
+          sendDevice(value,c);
+          break;
+        case 'k':     // turn confirmed switching on or off
+          swConfirm = value;
+          break;
         case 'p':     // poll a device
           sendDevice(value,c);
-          cmd = c;
           break;
         case 'c':     // config options
           modifyConf(value);
           break;
         case 'h': // modify and display RFM69 Frequency register
-          Serial.print("> FREQ set to: ");
-          rfm69_center_freq = RF_FREQ_BASE + hexToUInt16(freq);
-          rfm69_freq_carrier_khz(rfm69_center_freq);
-          Serial.println(rfm69_center_freq);
-          freq = String("");
+          outStr("> FREQ set to: ");
+          rfm69_center_freq = RF_FREQ_BASE + freqHex;
+          setFreq(rfm69_center_freq);
+          outDec(rfm69_center_freq);
+          outLn();
+          freqMode = 0;
+          freqHex = 0;
           break;
       }
       value = top = 0;
       memset(stack, 0, sizeof stack);
   } else if (c == '+' || c == '-' || c == '#') {
+    PCA_STAT(pcaStats.cmds++);
     switch (c) {
       case '+': // modify and display RFM69 Frequency register
       case '-': // modify and display RFM69 Frequency register
-        Serial.print("> FREQ");
+        outStr("> FREQ");
         if (c == '+')
           rfm69_center_freq += 1;
         else
           rfm69_center_freq -= 1;
-        rfm69_freq_carrier_khz(rfm69_center_freq);
-        Serial.print(c);
-        Serial.print(": "); 
-        Serial.println(rfm69_center_freq);
+        setFreq(rfm69_center_freq);
+        outChar(c);
+        outStr(": "); 
+        outDec(rfm69_center_freq);
+        outLn();
         break;
       case '#': // test
         break;
     }
     value = 0;
-    freq = String("");
+    freqMode = 0;
+    freqHex = 0;
   } else if (' ' < c && c < 'A')
     showHelp();
 }
 
-uint16_t hexToUInt16(String hexString) {
-  
-  uint16_t UInt16Value = 0;
-  int nextInt;
-  
-  for (int i = 0; i < hexString.length(); i++) {
-    
-    nextInt = int(hexString.charAt(i));
-    if (nextInt >= 48 && nextInt <= 57) nextInt = map(nextInt, 48, 57, 0, 9);
-    if (nextInt >= 65 && nextInt <= 70) nextInt = map(nextInt, 65, 70, 10, 15);
-    if (nextInt >= 97 && nextInt <= 102) nextInt = map(nextInt, 97, 102, 10, 15);
-    nextInt = constrain(nextInt, 0, 15);
-    
-    UInt16Value = (UInt16Value * 16) + nextInt;
-  }
-  
-  return UInt16Value;
+//- value of a hex digit, -1 if it is none ---------------------------------------------------------
+static int8_t hexDigit(char c) {
+  if ('0' <= c && c <= '9')
+    return c - '0';
+  if ('A' <= c && c <= 'F')
+    return c - 'A' + 10;
+  if ('a' <= c && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
 }
 
 void displayVersion(uint8_t newline) {
-  Serial.print("\n[");
-  Serial.print(PROGNAME);
-  Serial.print('.');
-  Serial.print(PROGVERS);
-  Serial.print(']');  
+  outStr("\n[");
+  outStr(PROGNAME);
+  outChar('.');
+  outStr(PROGVERS);
+  outChar(']');  
   if (newline!=0)
-    Serial.println();
+    outLn();
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -494,12 +1830,14 @@ void pca301serial_setup() {
   // switch off LED
   activityLed(0);
 
-  // available cli options
-  showHelp();
+  // available cli options are shown once a host sends something
+  helpDue = 1;
 
-  // try loading config from EEPROM. if CRC does not match, use blank default config
-  if (!loadConf())
-    fillConf();
+  // seed poll jitter
+  rndState = hal_random(1, 0xffff);
+
+  // the radio already receives, the config is loaded from the loop
+  loadBegin();
 
   // quiet is default
   pcaConf.quiet  = 1;
@@ -507,28 +1845,132 @@ void pca301serial_setup() {
 }
 
 
+//- set carrier frequency on all radios ------------------------------------------------------------
+static void setFreq(uint32_t khz) {
+  rfm69_freq_carrier_khz(pca301_rfm69_tx, khz);
+  if (pca301_rfm69_rx != pca301_rfm69_tx)
+    rfm69_freq_carrier_khz(pca301_rfm69_rx, khz);
+}
+
+
+//- send done --------------------------------------------------------------------------------------
+static void sendDone(uint8_t result) {
+  activityLed(0);
+  if (result != RFM69_SEND_OK)
+    PCA_STAT(pcaStats.txFailed++);
+
+  // reply time counts from the end of the transmission
+  if (reqTx) {
+    struct_pcaReq *req = &reqTab[reqTx-1];
+    req->ts = hal_millis();
+    req->sent = 1;
+    replyWaitDev = req->devPtr;
+    replyWaitUntil = req->ts + (devRtt[req->devPtr-1] ? devRtt[req->devPtr-1] : rttAvg) * 3 / 2 + PCA_REPLY_GAP;
+    reqTx = 0;
+  }
+}
+
+//- report transceiver timeouts, the driver only counts them ---------------------------------------
+static void drvTask() {
+  const struct rfm69_err_stats *tx = rfm69_err_stats_get(pca301_rfm69_tx);
+  const struct rfm69_err_stats *rx = rfm69_err_stats_get(pca301_rfm69_rx);
+  uint16_t opmode = tx->opmode_timeouts + ((rx != tx) ? rx->opmode_timeouts : 0);
+
+  if (PCA_OUT_RING - outCnt < OUT_ROOM)
+    return;
+  if (opmode != drvOpmodeTo) {
+    drvOpmodeTo = opmode;
+    outStr("opmode: timeout");
+    outLn();
+  } else if (tx->send_timeouts != drvSendTo) {
+    drvSendTo = tx->send_timeouts;
+    outStr("send: timeout");
+    outLn();
+  }
+}
+
+
+//- send the next queued frame ---------------------------------------------------------------------
+static void txqSend() {
+  struct_pcaTx *tx = &txq[0];
+  unsigned long now = hal_millis();
+  uint8_t len = tx->len;
+  uint16_t crc;
+
+  // switch commands and pairing replies don't wait for outstanding replies
+  if (tx->prio == PCA_TX_POLL && replyWait(now))
+    return;
+
+#if PCA_STATS
+  uint16_t wait = now - tx->ts;
+  pcaStats.txFrames[tx->prio]++;
+  pcaStats.txDelaySum[tx->prio] += wait;
+  if (wait > pcaStats.txDelayMax[tx->prio])
+    pcaStats.txDelayMax[tx->prio] = wait;
+#endif
+
+  activityLed(1);
+
+  memcpy(pBuf, tx->data, len);
+
+  /* calculate CRC */
+  crc = crc16_pca301(pBuf, len);
+
+  /* add CRC to data stream */
+  pBuf[len++] = crc >> 8;
+  pBuf[len++] = crc & 0xff;
+
+  if (pca301_rfm69_rx != pca301_rfm69_tx) {
+    memcpy(txEcho, pBuf, len);
+    txEchoLen = len;
+  }
+
+  // track requests that get a reply, pairing answers don't
+  if (len == PCA_PAYLOAD_LEN && pBuf[1] != 17 && tx->devPtr)
+    reqTx = reqAdd(tx->devPtr, pBuf[1]);
+
+  txqCnt--;
+  memmove(&txq[0], &txq[1], txqCnt * sizeof txq[0]);
+
+  rfm69_send_async(pca301_rfm69_tx, len, pBuf, sendDone);
+}
+
+
 //- loop -------------------------------------------------------------------------------------------
 void pca301serial_loop_pre() {
+  struct rfm69_rx_frame *frame;
   uint16_t crc;
 
-  if (rfm69_rx_avail()) {
+  // move a received frame from the transceiver into the RX queue
+  rfm69_rx_poll(pca301_rfm69_rx);
 
-    rfm69_crc = 0;
-    while (true == rfm69_rx_avail()) {
-      uint8_t in = rfm69_fifo_data();
+  // previous frame not handled yet
+  if (rxfill)
+    return;
 
-      rfm69_buf[rxfill++] = in;
-      if (rxfill <= 10) {
-          rfm69_crc = crc16_pca301_update(rfm69_crc, in);
-      }
+  frame = rfm69_rx_peek(pca301_rfm69_rx);
+  if (frame) {
+    rxfill = (frame->len < PCA_PAYLOAD_LEN) ? frame->len : PCA_PAYLOAD_LEN;
+    memcpy(rfm69_buf, frame->data, rxfill);
+    rxTs = frame->ts;
+    rfm69_rx_pop(pca301_rfm69_rx);
+
+    // a separate RX radio hears our own transmission, drop it once
+    if (txEchoLen && rxfill == txEchoLen && !memcmp(rfm69_buf, txEcho, txEchoLen)) {
+      txEchoLen = 0;
+      rxfill = 0;
+      return;
     }
 
     /* compare CRC */
-    if (rxfill) {
-      crc = (rfm69_buf[10] << 8) | rfm69_buf[11];
-      if (crc == rfm69_crc) {
-          rfm69_crc = 0;
-      }
+    if (rxfill < PCA_PAYLOAD_LEN) {
+      rfm69_crc = 1;   // force bad crc on short frame
+      return;
+    }
+    rfm69_crc = crc16_pca301(rfm69_buf, PCA_PAYLOAD_LEN - 2);
+    crc = (rfm69_buf[10] << 8) | rfm69_buf[11];
+    if (crc == rfm69_crc) {
+        rfm69_crc = 0;
     }
   }
 }
@@ -536,178 +1978,288 @@ void pca301serial_loop_pre() {
 
 //- loop -------------------------------------------------------------------------------------------
 void pca301serial_loop() {
-  uint8_t cnt;
 
   pca301serial_loop_pre();
 
-  if (Serial.available()) {
-    handleInput(Serial.read());
+  // boot: scan the config log in steps, received frames wait in the RX queue
+  if (loadSlot < PCA_LOG_SLOTS) {
+    if (loadStep()) {
+      if (!loadFound)
+        fillConf();            // no intact record, use blank default config
+      PCA_STAT(pcaStats.bootMs = hal_millis());
+    }
+    return;
   }
 
-  if (!cmd) {
-    pcaTask();                 // check tasks
+  // drain the bytes already received, a full TX queue, a long reply still printing or a lack of
+  // room for a short reply holds further input back in the serial buffer
+  for (int n = hal_serial_available(); n > 0 && txqCnt < PCA_TXQ_LEN; n--) {
+    if (outJob || loadDue || PCA_OUT_RING - outCnt < OUT_JOB_ROOM)
+      break;
+    if (helpDue) {
+      helpDue = 0;
+      showHelp();
+      break;
+    }
+    handleInput(hal_serial_read());
   }
 
-  if ((RFM69_OPMODE_RX == rfm69_opmode_get()) && rxfill) {
+  reqCheck();                  // expire unanswered requests
+  swCheck();                   // retransmit unconfirmed switch commands
+  grpTask();                   // queue group switch frames
+  pairTask();                  // queue pairing answer
+  confTask();                  // write changed device records to EEPROM
+  loadTask();                  // reload the config once all records are written
+
+  pcaTask();                   // queue the next due poll
 
-    /* clear fifo */
-    rfm69_fifo_clear();
+  // queued frames are handled even while a frame is on air
+  if (rxfill) {
+    byte drop = 0;                     // filtered in quiet mode, the tasks below still run
 
     if (rfm69_len > RFM69_MAXDATA) {
       rfm69_crc = 1;   // force bad crc if packet length is invalid
-      Serial.println("bad CRC");
+      outStr("bad CRC");
+      outLn();
 
     }
 
-    byte n = 10;               // fixed packet length
     if (rfm69_crc == 0) {
+#if PCA_STATS
+      if (!pcaStats.firstRxMs)
+        pcaStats.firstRxMs = hal_millis();
+#endif
 
       // in quiet mode, suppress as much packets as possible from non-PCA301 transmitters
       if (pcaConf.quiet && rfm69_buf[0] != 0) {
         // quiet mode and not a pairing request
         if (mem2long(rfm69_buf+6) == 0xFFFFFFFF) {
           // originator is another JeeLink
-          rxfill = 0;
-          rfm69_crc = 0;
-          return;
+          drop = 1;
         }
         if (rfm69_buf[1] != 5 && mem2long(rfm69_data+6) == 0xAAAAAAAA) {
           // originator is a hardware display unit
-          rxfill = 0;
-          rfm69_crc = 0;
-          return;
+          drop = 1;
         }
         // all non PCA301 packets filtered EXCEPT switch command from hardware display unit      
       }
-      activityLed(1);
-      Serial.print("OK");
+      if (!drop)
+        activityLed(1);
     } else {
       if (pcaConf.quiet) {     // don't report bad packets in quiet mode
-        rxfill = 0;
-        rfm69_crc = 0;
-        return;
+        drop = 1;
       }
-      Serial.print(" ?");
     }
 
-    Serial.print(' ');
-    Serial.print(NODEID);
-
-    // FHEM quick fix - unpaired devices get listed with channel 0
-      Serial.print(' ');
-    if (rfm69_buf[0] == 0) {
-      showByte(pBuf[1]);
-    } else {
-      showByte(rfm69_buf[0]);
-    }
+    if (!drop) {
+      // change-driven reports leave replies of known devices to repTask()
+      rxShown = !repHold();
+      if (rxShown) {
+        uint8_t frame[PCA_PAYLOAD_LEN - 2];
+        memcpy(frame, rfm69_buf, sizeof frame);
+
+        // FHEM quick fix - unpaired devices get listed with channel 0
+        if (rfm69_buf[0] == 0)
+          frame[0] = pBuf[1];
+        showRX(rfm69_crc != 0, frame);
+      }
+      activityLed(0);
 
-    for (byte i = 1; i < n; ++i) {
-      Serial.print(' ');
-      showByte(rfm69_buf[i]);
+      if (rfm69_crc == 0)
+        analyzePacket();
     }
 
-    Serial.println();
-    activityLed(0);
-
-    if (rfm69_crc == 0)
-      analyzePacket();
-
     rxfill = 0;
     rfm69_crc = 0;
   }
 
-  if (cmd) {
-    activityLed(1);
+  // frames are sent in the background, a new one starts when the last is done
+  if (txqCnt && !rfm69_send_busy(pca301_rfm69_tx))
+    txqSend();
+
+  drvTask();                   // print transceiver timeouts
+  outJobTask();                // print the next line of a long command reply
+  repTask();                   // print a waiting change-driven report
+#if PCA_SAF
+  safTask();                   // print the next stored reading
+#endif
+  outTask();                   // serial output the UART takes without blocking
+}
 
-    /* calculate CRC */
-    rfm69_crc = 0;
-    for (cnt = 0; cnt < sendLen; cnt++) {
-        rfm69_crc = crc16_pca301_update(rfm69_crc, pBuf[cnt]);
-    }
 
-    /* add CRC to data stream */
-    pBuf[sendLen++] = rfm69_crc >> 8;
-    pBuf[sendLen++] = rfm69_crc & 0xff;
+//- read log record, returns 1 if it is intact -----------------------------------------------------
+static byte logRead(uint16_t slot, struct_pcaRec *rec) {
+  hal_eeprom_read_block(rec, slot * sizeof(struct_pcaRec), sizeof(struct_pcaRec));
+  return rec->devPtr && rec->devPtr <= PCA_MAXDEV
+    && rec->crc == crc16_pca301((byte*)rec, offsetof(struct_pcaRec, crc));
+}
 
-    rfm69_send(sendLen, pBuf);
-    cmd = 0;
-    sendLen = 0;
-    activityLed(0);
-  }
+//- sequence number of a record --------------------------------------------------------------------
+static uint32_t logSeqOf(const struct_pcaRec *rec) {
+  return (uint32_t)rec->seq[0] << 16 | (uint32_t)rec->seq[1] << 8 | rec->seq[2];
 }
 
+//- start loading the config from EEPROM, loadStep() scans the log ---------------------------------
+static void loadBegin() {
+  pcaConf.numDev   = 0;
+  pcaConf.pollIntv = PCA_POLL_INTV;
+  pcaConf.deadIntv = PCA_DEAD_INTV;
+  memset(pcaConf.pcaDev, 0, sizeof pcaConf.pcaDev);
+  memset(&pcaHot, 0, sizeof pcaHot);
+#if PCA_HIST
+  memset(pcaHist, 0, sizeof pcaHist);
+#endif
+  memset(logSlot, 0, sizeof logSlot);
+  memset(logLive, 0, sizeof logLive);
+  memset(logDirty, 0, sizeof logDirty);
+  logHead   = 0;
+  logSeq    = 0;
+  loadSlot  = 0;
+  loadFound = 0;
+}
 
-//- load config from EEPROM - returns 1 if valid config was found, otherwise 0
-static byte loadConf() {
-  uint16_t len   = sizeof(pcaConf);
-  byte *pPtrByte = (byte*)&pcaConf;        // byte Ptr to pcaConf
-  eeprom_crc     = 0;
-  eeprom_read_block(&pcaConf, (void *) 0, len);
-
-  for (int i=0; i < (len - 2); i++) {
-    eeprom_crc = crc16_pca301_update(eeprom_crc, *pPtrByte);
-    pPtrByte++;
-  }
-
-  // valid config in EEPROM?
-  if (eeprom_crc == pcaConf.crc) {
-    // valid config found, reset dynamic settings
-    for (int i = 0; i < pcaConf.numDev; i++) {
-      pcaConf.pcaDev[i].pNow    = 0;
-      pcaConf.pcaDev[i].pTtl    = 0;
-      pcaConf.pcaDev[i].nextTX  = 0;
-      pcaConf.pcaDev[i].retries = 0;
+//- scan the next PCA_LOAD_STEP log slots - returns 1 once the whole log is read -------------------
+static byte loadStep() {
+  struct_pcaRec rec, cur;
+  uint32_t seq;
+
+  // the newest intact record of every device counts, a corrupt one only costs its own device
+  for (uint8_t n = 0; n < PCA_LOAD_STEP && loadSlot < PCA_LOG_SLOTS; n++, loadSlot++) {
+    if (!logRead(loadSlot, &rec))
+      continue;
+
+    seq = logSeqOf(&rec);
+    if (!loadFound || seq + 1 >= logSeq) {
+      logHead   = (loadSlot + 1) % PCA_LOG_SLOTS;
+      logSeq    = seq + 1;
+      loadFound = 1;
     }
-    return 1;
-  } else {
-    // invalid crc
-    return 0;
+
+    uint16_t *live = &logSlot[rec.devPtr-1];
+    if (*live) {
+      logRead(*live - 1, &cur);
+      if (logSeqOf(&cur) > seq)
+        continue;
+      mapClr(logLive, *live - 1);
+    }
+    *live = loadSlot + 1;
+    mapSet(logLive, loadSlot);
+    pcaConf.pcaDev[rec.devPtr-1] = rec.dev;
   }
+  if (loadSlot < PCA_LOG_SLOTS)
+    return 0;
+
+  // missing or erased devices below the last one stay free for the next new device
+  pcaConf.numDev = PCA_MAXDEV;
+  while (pcaConf.numDev && !devIdOf(pcaConf.numDev))
+    pcaConf.numDev--;
+
+  devIdxBuild();
+  schedBuild();
+  return 1;
+}
+
+//- load config from EEPROM - returns 1 if valid config was found, otherwise 0
+static byte loadConf() {
+  loadBegin();
+  while (!loadStep());
+  return loadFound;
+}
+
+//- reload asked for by 1c: dirty and in-flight records are written first, they would be lost ------
+static void loadTask() {
+  if (!loadDue || hal_eeprom_busy())
+    return;
+  for (uint8_t i = 0; i < sizeof logDirty; i++)
+    if (logDirty[i])
+      return;
+  loadDue = 0;
+  loadConf();
 }
 
-// save config to EEPROM
+//- write the record of a changed device in the background -----------------------------------------
+static void confChanged(uint8_t devPtr) {
+  mapSet(logDirty, devPtr - 1);
+}
+
+// save config to EEPROM, rewrites all devices
 static void saveConf() {
-  uint16_t len = sizeof(pcaConf);
-  byte *pPtrByte = (byte*)&pcaConf;        // byte Ptr to pcaConf
+  for (uint8_t i = 1; i <= pcaConf.numDev; i++)
+    confChanged(i);
+}
+
+//- append the next dirty device record, slots holding the newest record of a device are kept ------
+static void confTask() {
+  uint8_t devPtr = 0;
 
-  eeprom_crc = 0;
-  for (int i=0; i < (len - 2); i++) {
-    eeprom_crc = crc16_pca301_update(eeprom_crc, *pPtrByte);
-    pPtrByte++;
+  if (hal_eeprom_busy())
+    return;
+
+  for (uint8_t i = 0; i < sizeof logDirty; i++) {
+    if (logDirty[i]) {
+      devPtr = i * 8 + 1;
+      while (!mapGet(logDirty, devPtr - 1))
+        devPtr++;
+      break;
+    }
   }
-  pcaConf.crc = eeprom_crc;
-  
-  eeprom_write_block(&pcaConf, (void *) 0, len);
+  if (!devPtr)
+    return;
+  mapClr(logDirty, devPtr - 1);
+
+  // devices beyond numDev are erased, nothing to do if they never were stored
+  if (devPtr > pcaConf.numDev && !logSlot[devPtr-1])
+    return;
+
+  while (mapGet(logLive, logHead))
+    logHead = (logHead + 1) % PCA_LOG_SLOTS;
+
+  logRec.seq[0]   = logSeq >> 16;
+  logRec.seq[1]   = logSeq >> 8;
+  logRec.seq[2]   = logSeq;
+  logRec.devPtr   = devPtr;
+  if (devPtr <= pcaConf.numDev)
+    logRec.dev    = pcaConf.pcaDev[devPtr-1];
+  else
+    memset(&logRec.dev, 0, sizeof logRec.dev);
+  logRec.crc      = crc16_pca301((byte*)&logRec, offsetof(struct_pcaRec, crc));
+  hal_eeprom_write_async(&logRec, logHead * sizeof(struct_pcaRec), sizeof(struct_pcaRec));
+
+  // the old record stays valid until the new one is complete
+  if (logSlot[devPtr-1])
+    mapClr(logLive, logSlot[devPtr-1] - 1);
+  logSlot[devPtr-1] = logHead + 1;
+  mapSet(logLive, logHead);
+  logHead = (logHead + 1) % PCA_LOG_SLOTS;
+  logSeq++;
 }
 
 // erase config
 static void eraseConf() {
+  saveConf();
   pcaConf.numDev = 0;
+  devIdxBuild();
+  schedBuild();
 }
 
 //- fill config ------------------------------------------------------------------------------------
 static void fillConf() {
+  saveConf();                                           // erase stored devices
   pcaConf.numDev     = 0;
-  pcaConf.pollIntv   = 300;                             // default poll interval in 1/10th seconds
-  pcaConf.deadIntv   = 3000;                            // dead device poll retry interval in 1/10th seconds
+  pcaConf.pollIntv   = PCA_POLL_INTV;
+  pcaConf.deadIntv   = PCA_DEAD_INTV;
   pcaConf.quiet      = 1;                               // quiet, 1=suppress TX and bad packets
   
-  pcaConf.pcaDev[0]  = (struct_pcaDev){1 ,0xAAAAA};    // device 1
-  pcaConf.pcaDev[1]  = (struct_pcaDev){2 ,0xBBBBB};    // device 2
+  pcaConf.pcaDev[0]  = (struct_pcaDev){1, {0x0A, 0xAA, 0xAA}};   // device 1
+  pcaConf.pcaDev[1]  = (struct_pcaDev){2, {0x0B, 0xBB, 0xBB}};   // device 2
+  memset(&pcaHot, 0, sizeof pcaHot);
+#if PCA_HIST
+  memset(pcaHist, 0, sizeof pcaHist);
+#endif
+  devIdxBuild();
+  schedBuild();
 }
 
-
-static uint16_t crc16_pca301_update(uint16_t crc, uint8_t data) {
-  int i;
-  crc = crc ^ ((uint16_t)data << 8);
-  for (i=0; i<8; i++) {
-    if (crc & 0x8000)
-      crc = (crc << 1) ^ 0x8005;
-    else
-      crc <<= 1;
-  }
-  return crc;
-}
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 // E N D
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -